@@ -17,6 +17,8 @@
 
 namespace PhysicsTools {
 
+namespace detail { template<unsigned int Hash> struct AtomicIdLiteral; }
+
 /** \class AtomicId
  *
  * \short Cheap generic unique keyword identifier class.
@@ -28,6 +30,10 @@ namespace PhysicsTools {
  * very cheap. An AtomicId instance requires the size of a pointer and is
  * therefore suited for direct inlining.
  *
+ * Identifiers for string literals can be created with MVA_ATOMIC_ID,
+ * which computes the hash at compile time and interns the string only
+ * once per call site.
+ *
  ************************************************************/
 class AtomicId {
     public:
@@ -51,6 +57,10 @@ class AtomicId {
 	inline operator bool() const throw()
 	{ return string != 0; }
 
+	/// dense number of the identifier in order of interning, 0 for null
+	inline unsigned int serial() const throw()
+	{ return string ? reinterpret_cast<const unsigned int*>(string)[-1] : 0; }
+
 	/// implicit cast to a STL string
 	inline operator std::string() const throw()
 	{ return std::string(string); }
@@ -62,17 +72,52 @@ class AtomicId {
 	inline bool operator >  (const AtomicId &second) const throw() { return string >  second.string; }
 	inline bool operator >= (const AtomicId &second) const throw() { return string >= second.string; }
 
+#ifndef __GCCXML__
+	/// FNV-1a hash of \a arg, as used by the interning table
+	static constexpr unsigned int
+	hash(const char *arg, unsigned int value = 2166136261U) throw()
+	{ return *arg ? hash(arg + 1, (value ^ (unsigned char)*arg) * 16777619U) : value; }
+#endif
+
     private:
+	template<unsigned int Hash> friend struct detail::AtomicIdLiteral;
+
+	/// constructs an AtomicId from a C string with precomputed \a Hash
+	template<unsigned int Hash>
+	static AtomicId literal(const char *arg) throw()
+	{ return build(lookup(arg, Hash)); }
+
 	static AtomicId build(const char *arg) throw() { AtomicId q; q.string = arg; return q; }
 	static const char *lookup(const char *arg) throw();
+	static const char *lookup(const char *arg, unsigned int hash) throw();
 
 	const char	*string;
 };
 
+namespace detail {
+	/// only used by MVA_ATOMIC_ID, which computes \a Hash from the literal
+	template<unsigned int Hash>
+	struct AtomicIdLiteral {
+		static AtomicId get(const char *arg) throw()
+		{ return AtomicId::literal<Hash>(arg); }
+	};
+} // namespace detail
+
 /// STL streaming operator
 inline std::ostream &operator << (std::ostream &os, const PhysicsTools::AtomicId &id)
 { return os << (const char*)id; }
 
 } // namespace PhysicsTools
 
+#ifndef __GCCXML__
+/// AtomicId for string literal \a name, interned once per call site
+#define MVA_ATOMIC_ID(name)						\
+	([]() -> ::PhysicsTools::AtomicId {				\
+		static const ::PhysicsTools::AtomicId id =		\
+			::PhysicsTools::detail::AtomicIdLiteral<	\
+				::PhysicsTools::AtomicId::hash(name)>::get(name); \
+		return id;						\
+	}())
+#endif
+
 #endif // PhysicsTools_MVAComputer_AtomicId_h
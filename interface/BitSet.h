@@ -12,9 +12,10 @@
 // $Id: BitSet.h,v 1.4 2007/12/08 16:11:10 saout Exp $
 //
 
-#include <string.h>
+#include <stdint.h>
 #include <cstddef>
 #include <cstring>
+#include <vector>
 
 namespace PhysicsTools {
 
@@ -25,6 +26,7 @@ namespace PhysicsTools {
  * BitSet provides a container of boolean values, similar to
  * a std::vector<bool> which only consumes one actual bit for each value.
  * Also an iterator is provided that can iterate over all set bits.
+ * Small sets are stored inline without allocating memory.
  *
  ************************************************************/
 class BitSet {
@@ -32,7 +34,7 @@ class BitSet {
 	typedef std::size_t size_t;
 
     protected:
-	typedef unsigned int Word_t;
+	typedef uint64_t Word_t;
 
     public:
 	/** \class Manipulator
@@ -88,9 +90,9 @@ class BitSet {
 		Iterator &operator ++ ()
 		{
 			if (++pos < wordSize) {
-				Word_t word = *store & -(1 << pos);
+				Word_t word = *store & (~(Word_t)0 << pos);
 				if (word) {
-					pos = ffs(word) - 1;
+					pos = __builtin_ctzll(word);
 					return *this;
 				}
 			}
@@ -100,7 +102,7 @@ class BitSet {
 				if (++store >= end)
 					break;
 				else if (*store) {
-					pos = ffs(*store) - 1;
+					pos = __builtin_ctzll(*store);
 					break;
 				}
 			}
@@ -124,41 +126,34 @@ class BitSet {
 		unsigned int	pos;
 	};
 
-	BitSet() : store(0), bits_(0) {}
+	BitSet() : store(inlineStore), bits_(0) {}
 
 	BitSet(const BitSet &orig) : bits_(orig.bits_)
 	{
 		std::size_t words = bitsToWords(bits_);
-		if (words) {
-			store = new Word_t[words];
-			std::memcpy(store, orig.store, words * sizeof(Word_t));
-		} else
-			store = 0;
+		store = allocate(words);
+		std::memcpy(store, orig.store, words * sizeof(Word_t));
 	}
 
 	/// construct BitSet with a fixed size of \a bits bits
 	BitSet(size_t bits) : bits_(bits)
 	{
 		std::size_t words = bitsToWords(bits);
-		if (words) {
-			store = new Word_t[words];
-			std::memset(store, 0, sizeof(Word_t) * words);
-		} else
-			store = 0;
+		store = allocate(words);
+		std::memset(store, 0, sizeof(Word_t) * words);
 	}
 
-	inline ~BitSet() { delete[] store; }
+	inline ~BitSet() { release(); }
 
 	BitSet &operator = (const BitSet &orig)
 	{
-		delete[] store;
+		if (this == &orig)
+			return *this;
+		release();
 		bits_ = orig.bits_;
 		std::size_t words = bitsToWords(bits_);
-		if (words) {
-			store = new Word_t[words];
-			std::memcpy(store, orig.store, words * sizeof(Word_t));
-		} else
-			store = 0;
+		store = allocate(words);
+		std::memcpy(store, orig.store, words * sizeof(Word_t));
 		return *this;
 	}
 
@@ -180,14 +175,25 @@ class BitSet {
 	inline Iterator iter() const
 	{ return Iterator(store, store + bitsToWords(bits_)); }
 
+	/// returns the indices of all set bits in ascending order
+	std::vector<unsigned int> indices() const;
+
     private:
 	static inline size_t bitsToWords(std::size_t bits)
 	{ return (bits + wordSize - 1) / wordSize; }
 
+	inline Word_t *allocate(std::size_t words)
+	{ return words > inlineWords ? new Word_t[words] : inlineStore; }
+
+	inline void release()
+	{ if (store != inlineStore) delete[] store; }
+
 	static const unsigned int wordSize = sizeof(Word_t) * 8;
+	static const unsigned int inlineWords = 2;
 
 	Word_t	*store;
 	size_t	bits_;
+	Word_t	inlineStore[inlineWords];
 };
 
 namespace Calibration {
@@ -13,9 +13,12 @@
 //
 
 #include <iostream>
+#include <utility>
 #include <vector>
 #include <memory>
 
+#include "FWCore/Utilities/interface/Digest.h"
+
 #include "PhysicsTools/MVAComputer/interface/CalibrationFwd.h"
 #include "PhysicsTools/MVAComputer/interface/VarProcessor.h"
 #include "PhysicsTools/MVAComputer/interface/Variable.h"
@@ -45,6 +48,10 @@ class MVAComputer {
 	/// construct a discriminator computer from a calibation object
 	MVAComputer(Calibration::MVAComputer *calib, bool owned = false);
 
+	/// construct a discriminator computer from a const calibration object, taking over unchanged variable processors from \a previous
+	MVAComputer(const Calibration::MVAComputer *calib,
+	            MVAComputer *previous);
+
 	~MVAComputer();
 
 	/// evaluate variables given by a range of iterators given by \a first and \a last
@@ -71,6 +78,39 @@ class MVAComputer {
 						values.begin(), values.end());
 	}
 
+	/// evaluate variables in columnar list \a values
+	double eval(const Variable::ValueColumns &values) const;
+
+	double deriv(Variable::ValueColumns &values) const;
+
+	/// evaluate \a n events at once, \a columns[j][i] is the value of variable \a names[j] in event \a i or NaN if absent
+	void eval(const std::vector<AtomicId> &names,
+	          const std::vector<const double*> &columns,
+	          unsigned int n, double *results) const;
+
+	/** \class InputSource
+	 * \short computes input variables on request of the evaluation
+	 */
+	struct InputSource {
+		virtual ~InputSource() {}
+
+		/// value of variable \a names[i] passed to evalLazy
+		virtual double value(unsigned int i) const = 0;
+	};
+
+	/// evaluate with the single-valued inputs \a names computed by \a source only when a processor the output depends on reads them
+	double evalLazy(const std::vector<AtomicId> &names,
+	                const InputSource &source) const;
+
+	/// names of the input variables, only those the evaluation reads if \a usedOnly is set
+	std::vector<AtomicId> variables(bool usedOnly = false) const;
+
+	/// whether all processors can be evaluated by several threads at once
+	bool threadSafe() const;
+
+	/// number of processors taken over from the previous computer
+	unsigned int reused() const { return nReused; }
+
 	/* various methods for standalone use of calibration files */
 
 	/// read calibration object from plain file
@@ -107,6 +147,10 @@ class MVAComputer {
 		/// number of times each appearance of that variable can appear while computing the discriminator
 		unsigned int	multiplicity;
 
+		/// whether the output variable depends on this input variable,
+		/// or a processor that cannot be skipped reads it
+		bool		used;
+
 		bool operator < (AtomicId id) const
 		{ return var.getName() < id; }
 
@@ -119,30 +163,58 @@ class MVAComputer {
 	 */
 	struct Processor {
 		inline Processor(VarProcessor *processor,
-		                 unsigned int nOutput) :
-			processor(processor), nOutput(nOutput) {}
+		                 unsigned int nOutput,
+		                 const cms::MD5Result &digest) :
+			processor(processor), nOutput(nOutput),
+			digest(digest), used(true), skipped(false), guard(-1) {}
 
 		inline Processor(const Processor &orig)
-		{ processor = orig.processor; nOutput = orig.nOutput; }
+		{ processor = orig.processor; nOutput = orig.nOutput; digest = orig.digest; used = orig.used; skipped = orig.skipped; guard = orig.guard; }
 
 		inline Processor &operator = (const Processor &orig)
-		{ processor = orig.processor; nOutput = orig.nOutput; return *this; }
+		{ processor = orig.processor; nOutput = orig.nOutput; digest = orig.digest; used = orig.used; skipped = orig.skipped; guard = orig.guard; return *this; }
 
 		/// owned variable processor instance
 		mutable std::auto_ptr<VarProcessor>	processor;
 
 		/// number of output variables
 		unsigned int				nOutput;
+
+		/// digest of the processor calibration (invalid if not tracked)
+		cms::MD5Result				digest;
+
+		/// whether the output variable depends on this processor
+		bool					used;
+
+		/// unused with single-valued outputs, never evaluated
+		bool					skipped;
+
+		/// variable whose value zero makes the outputs unused, or -1
+		int					guard;
 	};
 
 	struct EvalContext {
+		/// processors with a zero guard variable are not evaluated
+		static const bool skipInactive = true;
+
 		EvalContext(double *values, int *conf, unsigned int n) :
 			values_(values), conf_(conf), n_(n) {}
 
-		inline void eval(const VarProcessor *proc, int *outConf,
+		inline void eval(const Processor &proc, int *outConf,
 		                 double *output, int *loop,
 		                 unsigned int offset, unsigned int out) const
-		{ proc->eval(values_, conf_, output, outConf, loop, offset); }
+		{ proc.processor->eval(values_, conf_, output, outConf, loop,
+		                       offset); }
+
+		/// zero for the single-valued outputs of a skipped processor
+		inline void skip(int *outConf, double *output,
+		                 unsigned int out) const
+		{
+			for(unsigned int i = 0; i < out; i++) {
+				output[i] = 0.0;
+				outConf[i + 1] = outConf[i] + 1;
+			}
+		}
 
 		inline double output(unsigned int output) const
 		{ return values_[conf_[output]]; }
@@ -157,12 +229,17 @@ class MVAComputer {
 	};
 
 	struct DerivContext {
+		static const bool skipInactive = false;
+
 		DerivContext() : n_(0) {}
 
-		void eval(const VarProcessor *proc, int *outConf,
+		void eval(const Processor &proc, int *outConf,
 		          double *output, int *loop,
 		          unsigned int offset, unsigned int out) const;
 
+		void skip(int *outConf, double *output,
+		          unsigned int out) const;
+
 		double output(unsigned int output,
 		              std::vector<double> &derivs) const;
 
@@ -175,12 +252,80 @@ class MVAComputer {
 		mutable std::vector<int>	conf_;
 		unsigned int			n_;
 	};
+
+	/// input variables are computed before the first processor reads them
+	struct LazyContext : public EvalContext {
+		LazyContext(double *values, int *conf, unsigned int n,
+		            unsigned int nInputs, int *pending,
+		            const InputSource &source) :
+			EvalContext(values, conf, n), nInputs(nInputs),
+			pending(pending), source(source) {}
+
+		inline void eval(const Processor &proc, int *outConf,
+		                 double *output, int *loop,
+		                 unsigned int offset, unsigned int out) const
+		{
+			if (proc.used)
+				pull(proc.processor->inputIndices);
+			EvalContext::eval(proc, outConf, output, loop,
+			                  offset, out);
+		}
+
+		inline double output(unsigned int output) const
+		{
+			if (output < nInputs)
+				pull(output);
+			return EvalContext::output(output);
+		}
+
+		/// compute input variable \a index if still pending
+		inline void pull(unsigned int index) const
+		{
+			int &i = pending[index];
+			if (i >= 0) {
+				values_[conf_[index]] = source.value(i);
+				i = -1;
+			}
+		}
+
+		/// compute the pending inputs among the sorted \a indices
+		void pull(const std::vector<unsigned int> &indices) const;
+
+		unsigned int		nInputs;
+		int			*pending;
+		const InputSource	&source;
+	};
 	
 	/// construct processors from calibration and setup variables
-	void setup(const Calibration::MVAComputer *calib);
+	void setup(const Calibration::MVAComputer *calib,
+	           MVAComputer *previous = 0, bool track = false,
+	           std::vector<std::pair<unsigned int,
+	                                 unsigned int> > *taken = 0);
+
+	/// find the guard variables of the processors
+	void setupGuards(VarProcessor::ConfigCtx &config);
+
+	/// digest of processor \a index of \a calib, computed once per calibration
+	static cms::MD5Result digest(const Calibration::MVAComputer *calib,
+	                             unsigned int index,
+	                             const Calibration::VarProcessor *proc);
+
+	/// compute digest of persistent processor calibration \a calib
+	static cms::MD5Result digest(const Calibration::VarProcessor *calib);
 
 	/// map variable identifier \a name to the numerical position in the array
-	unsigned int getVariableId(AtomicId name) const;
+	inline unsigned int getVariableId(AtomicId name) const;
+
+	/// slow path of getVariableId, searches inputVariables
+	unsigned int findVariableId(AtomicId name) const;
+
+	/// whether \a n input values are few enough for the sparse set-up
+	inline bool isSparse(unsigned int n) const
+	{ return n * 8 < inputVariables.size(); }
+
+	/// compute conf offsets for \a n values of variables \a ids, only visiting present variables, returns the value array estimate
+	unsigned int sparseOffsets(int *conf, const unsigned int *ids,
+	                           unsigned int n) const;
 
 	/// evaluate discriminator from flattened variable array
 	template<class T> void evalInternal(T &ctx) const;
@@ -188,6 +333,12 @@ class MVAComputer {
 	/// vector of input variables
 	std::vector<InputVar>	inputVariables;
 
+	/// variable index for each AtomicId serial number, offset by serialBase
+	std::vector<unsigned int> variableSlots;
+
+	/// smallest AtomicId serial number of the input variables
+	unsigned int		serialBase;
+
 	/// vector of variable processors
 	std::vector<Processor>	varProcessors;
 
@@ -197,6 +348,9 @@ class MVAComputer {
 	/// index of the variable in the "conf" array to return as result
 	unsigned int		output;
 
+	/// number of processors taken over at construction
+	unsigned int		nReused;
+
 	/// in case calibration object is owned by the MVAComputer
 	std::auto_ptr<Calibration::MVAComputer> owned;
 };
@@ -12,8 +12,12 @@
 // $Id: MVAComputerCache.h,v 1.1 2007/12/08 16:11:11 saout Exp $
 //
 
+#include <exception>
 #include <memory>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
 #include "FWCore/Framework/interface/EventSetup.h"
 #include "FWCore/Framework/interface/ESHandle.h"
 #include "PhysicsTools/MVAComputer/interface/Calibration.h"
@@ -25,10 +29,33 @@ namespace PhysicsTools {
  *
  * \short Creates and and MVAComputer from calibrations via EventSetup
  *
+ * In asynchronous mode a changed calibration is copied and the new
+ * MVAComputer is built on a background thread, while evaluation keeps
+ * using the previous one. The replacement is published on the owning
+ * thread by the first update() that finds it built, which then returns
+ * true, or by wait(). Callers that evaluate concurrently with update()
+ * should hold a handle() for the duration of the evaluation, the
+ * previous computer is only deleted once the last handle is gone.
+ *
+ * In synchronous mode the previous computer stays in place until the
+ * replacement is built if a handle() to it is held. Otherwise the
+ * processors with unchanged calibration are taken over and the cache
+ * holds no computer during the build, so update() should be called on
+ * the thread that evaluates, or concurrent evaluations should hold a
+ * handle(). A failed build leaves the previous computer in place.
+ *
+ * In shared mode the computer is obtained from the MVAComputerRegistry,
+ * i.e. all caches looking at the same calibration use one instance.
+ *
  ************************************************************/
 class MVAComputerCache {
     public:
-	MVAComputerCache();
+	/// shared reference keeping a computer alive during evaluation
+	typedef boost::shared_ptr<const MVAComputer> Handle;
+
+	enum Mode { kSynchronous, kAsynchronous, kShared };
+
+	MVAComputerCache(Mode mode = kSynchronous);
 	~MVAComputerCache();
 
 	bool update(const Calibration::MVAComputer *computer);
@@ -68,25 +95,60 @@ class MVAComputerCache {
 		return update(handle.product(), calib);
 	}
 
-	operator bool() const { return computer.get(); }
+	operator bool() const { return get(); }
+
+	// the references and pointers are only valid until the next
+	// update(), concurrent evaluation should use a handle() instead
 
-	MVAComputer &operator * () { return *computer; }
-	const MVAComputer &operator * () const { return *computer; }
+	MVAComputer &operator * () { return *get(); }
+	const MVAComputer &operator * () const { return *get(); }
 
-	MVAComputer *operator -> () { return computer.get(); }
-	const MVAComputer *operator -> () const { return computer.get(); }
+	MVAComputer *operator -> () { return get(); }
+	const MVAComputer *operator -> () const { return get(); }
 
-	MVAComputer *get() { return computer.get(); }
-	const MVAComputer *get() const { return computer.get(); }
+	MVAComputer *get() { return boost::atomic_load(&computer).get(); }
+	const MVAComputer *get() const
+	{ return boost::atomic_load(&computer).get(); }
+
+	/// current computer, stays valid while the handle is held
+	Handle handle() const { return boost::atomic_load(&computer); }
+
+	Mode getMode() const { return mode; }
+
+	/// wait for a pending background rebuild and publish it
+	void wait();
 
 	std::auto_ptr<MVAComputer> release();
 
-	void reset() { computer.reset(); }
+	void reset();
 
     private:
+	class Builder;
+	friend class Builder;
+
+	// computers built by the cache itself, unlike shared ones
+	struct Deleter {
+		Deleter() : owned(true) {}
+		void operator () (MVAComputer *computer) const
+		{ if (owned) delete computer; }
+
+		bool		owned;
+	};
+
+	bool collect();
+	void publish(MVAComputer *computer);
+
 	Calibration::MVAComputerContainer::CacheId	containerCacheId;
 	Calibration::MVAComputer::CacheId		computerCacheId;
-	std::auto_ptr<MVAComputer>			computer;
+	Calibration::MVAComputer::CacheId		pendingCacheId;
+	boost::shared_ptr<MVAComputer>			computer;
+	/// built by the background thread, published by the owner
+	std::auto_ptr<MVAComputer>			pending;
+
+	const Mode					mode;
+	boost::thread					builder;
+	std::exception_ptr				error;
+	bool						published;
 };
 
 } // namespace PhysicsTools
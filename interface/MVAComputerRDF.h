@@ -0,0 +1,230 @@
+#ifndef PhysicsTools_MVAComputer_MVAComputerRDF_h
+#define PhysicsTools_MVAComputer_MVAComputerRDF_h
+// -*- C++ -*-
+//
+// Package:     MVAComputer
+// Class  :     MVAComputerRDF
+//
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <RVersion.h>
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+#	include <ROOT/RVec.hxx>
+#endif
+
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
+#include "PhysicsTools/MVAComputer/interface/Variable.h"
+#include "PhysicsTools/MVAComputer/interface/AtomicId.h"
+
+namespace PhysicsTools {
+
+namespace detail {
+	/// check that \a names are input variables of \a mva, one per column
+	inline std::vector<AtomicId>
+	bindColumns(const MVAComputer *mva,
+	            const std::vector<std::string> &names,
+	            unsigned int nColumns)
+	{
+		if (names.size() != nColumns)
+			throw cms::Exception("InvalidColumns")
+				<< "Got " << names.size() << " variable names "
+				   "for " << nColumns << " columns."
+				<< std::endl;
+
+		std::vector<AtomicId> inputs = mva->variables();
+		std::sort(inputs.begin(), inputs.end());
+
+		std::vector<AtomicId> result;
+		for(std::vector<std::string>::const_iterator iter =
+			names.begin(); iter != names.end(); ++iter) {
+			AtomicId name(*iter);
+			if (!std::binary_search(inputs.begin(), inputs.end(),
+			                        name))
+				throw cms::Exception("InvalidVariable")
+					<< "Input variable " << *iter
+					<< " not found." << std::endl;
+			result.push_back(name);
+		}
+
+		return result;
+	}
+
+	/// lock serializing the evaluation if \a mva is not thread safe
+	inline boost::shared_ptr<boost::mutex> serialize(const MVAComputer *mva)
+	{
+		return mva->threadSafe() ? boost::shared_ptr<boost::mutex>()
+		                         : boost::make_shared<boost::mutex>();
+	}
+
+	/// scalar column, NaN marks an absent optional value
+	inline void addColumn(Variable::ValueColumns &values,
+	                      AtomicId name, double value)
+	{
+		if (!std::isnan(value))
+			values.add(name, value);
+	}
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+	/// array column, one value per element
+	template<typename T>
+	inline void addColumn(Variable::ValueColumns &values, AtomicId name,
+	                      const ROOT::VecOps::RVec<T> &array)
+	{
+		for(typename ROOT::VecOps::RVec<T>::const_iterator iter =
+			array.begin(); iter != array.end(); ++iter)
+			values.add(name, *iter);
+	}
+#endif
+} // namespace detail
+
+/** \class MVAComputerRDF
+ *
+ * \short Column definition evaluating an MVAComputer in an RDataFrame
+ *
+ * The functor maps the columns passed by the data frame, in order, to
+ * the input variables \a names of the computer. The names are checked
+ * and interned once at construction. It is meant to be used with
+ * DefineSlot: every processing slot fills its own value list, which
+ * keeps its capacity from row to row, so one instance serves all
+ * threads of the implicit multithreading.
+ *
+ *   MVAComputerRDF<float, float, ROOT::RVec<float> > mva(
+ *           computer, names, df.GetNSlots());
+ *   df.DefineSlot("discr", mva, columns);
+ *
+ * Scalar columns equal to NaN are left out as absent optional values,
+ * array columns contribute one value per element. Computers that are
+ * not thread safe are evaluated by one slot at a time.
+ *
+ ************************************************************/
+template<typename... Columns>
+class MVAComputerRDF {
+    public:
+	MVAComputerRDF(const MVAComputer *mva,
+	               const std::vector<std::string> &names,
+	               unsigned int nSlots) :
+		mva(mva),
+		names(detail::bindColumns(mva, names, sizeof...(Columns))),
+		slots(nSlots, Variable::ValueColumns(sizeof...(Columns))),
+		lock(detail::serialize(mva))
+	{}
+
+	double operator () (unsigned int slot, Columns... columns)
+	{
+		Variable::ValueColumns &values = slots[slot];
+		values.clear();
+
+		const AtomicId *name = names.data();
+		int expand[] = {
+			0, (detail::addColumn(values, *name++, columns), 0)...
+		};
+		(void)expand;
+
+		if (lock) {
+			boost::mutex::scoped_lock scoped_lock(*lock);
+			return mva->eval(values);
+		}
+
+		return mva->eval(values);
+	}
+
+    private:
+	const MVAComputer			*mva;
+	std::vector<AtomicId>			names;
+	std::vector<Variable::ValueColumns>	slots;
+	boost::shared_ptr<boost::mutex>		lock;
+};
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+/** \class MVAComputerRDFBatch
+ *
+ * \short Column definition evaluating all objects of a row at once
+ *
+ * Each column is an array with one entry per object of the row (e.g.
+ * the jets of an event), all arrays of a row must have the same size.
+ * The result is an array with the discriminator of every object,
+ * computed by a single batch evaluation on per-slot column buffers.
+ * NaN marks an absent optional value. As for MVAComputerRDF, computers
+ * that are not thread safe are evaluated by one slot at a time.
+ *
+ ************************************************************/
+template<typename... Columns>
+class MVAComputerRDFBatch {
+    public:
+	MVAComputerRDFBatch(const MVAComputer *mva,
+	                    const std::vector<std::string> &names,
+	                    unsigned int nSlots) :
+		mva(mva),
+		names(detail::bindColumns(mva, names, sizeof...(Columns))),
+		slots(nSlots),
+		lock(detail::serialize(mva))
+	{}
+
+	static_assert(sizeof...(Columns) > 0, "no columns");
+
+	ROOT::VecOps::RVec<double>
+	operator () (unsigned int slot,
+	             const ROOT::VecOps::RVec<Columns>&... columns)
+	{
+		Slot &buffers = slots[slot];
+		std::size_t sizes[] = { columns.size()... };
+		std::size_t n = sizes[0];
+		for(unsigned int i = 1; i < sizeof...(Columns); i++)
+			if (sizes[i] != n)
+				throw cms::Exception("InvalidColumns")
+					<< "Columns of different sizes in "
+					   "one row." << std::endl;
+
+		ROOT::VecOps::RVec<double> results(n);
+		if (!n)
+			return results;
+
+		buffers.columns.resize(sizeof...(Columns));
+		buffers.pointers.resize(sizeof...(Columns));
+		std::vector<double> *column = &buffers.columns.front();
+		int expand[] = { 0, (fill(*column++, columns), 0)... };
+		(void)expand;
+
+		for(unsigned int i = 0; i < sizeof...(Columns); i++)
+			buffers.pointers[i] = &buffers.columns[i].front();
+
+		if (lock) {
+			boost::mutex::scoped_lock scoped_lock(*lock);
+			mva->eval(names, buffers.pointers, n, &results.front());
+		} else
+			mva->eval(names, buffers.pointers, n, &results.front());
+
+		return results;
+	}
+
+    private:
+	struct Slot {
+		std::vector<std::vector<double> >	columns;
+		std::vector<const double*>		pointers;
+	};
+
+	template<typename T>
+	static void fill(std::vector<double> &buffer,
+	                 const ROOT::VecOps::RVec<T> &column)
+	{ buffer.assign(column.begin(), column.end()); }
+
+	const MVAComputer			*mva;
+	std::vector<AtomicId>			names;
+	std::vector<Slot>			slots;
+	boost::shared_ptr<boost::mutex>		lock;
+};
+#endif
+
+} // namespace PhysicsTools
+
+#endif // PhysicsTools_MVAComputer_MVAComputerRDF_h
@@ -0,0 +1,97 @@
+#ifndef PhysicsTools_MVAComputer_MVAComputerRegistry_h
+#define PhysicsTools_MVAComputer_MVAComputerRegistry_h
+// -*- C++ -*-
+//
+// Package:     MVAComputer
+// Class  :     MVAComputerRegistry
+//
+
+#include <cstddef>
+#include <string>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "PhysicsTools/MVAComputer/interface/CalibrationFwd.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
+
+namespace PhysicsTools {
+
+/** \class MVAComputerRegistry
+ *
+ * \short Process-wide pool of MVAComputer instances shared between modules
+ *
+ * Computers are identified by the cache identifier of the calibration
+ * object they were built from and the label inside the container, so
+ * all consumers of the same calibration in the same IOV receive the
+ * same instance. The registry only holds weak references, a computer
+ * is deleted as soon as the last consumer has dropped its reference.
+ *
+ * Computers with processors that are not thread safe are never shared,
+ * every consumer receives its own instance.
+ *
+ ************************************************************/
+class MVAComputerRegistry {
+    public:
+	typedef boost::shared_ptr<const MVAComputer> Handle;
+
+	/// the registry instance of the process
+	static MVAComputerRegistry &instance();
+
+	/// computer for calibration \a calib in \a container
+	Handle get(const Calibration::MVAComputerContainer *container,
+	           const char *calib);
+
+	/// computer for standalone calibration \a computer
+	Handle get(const Calibration::MVAComputer *computer);
+
+	/// number of computers currently alive
+	std::size_t size() const;
+
+    private:
+	friend class MVAComputerCache;
+
+	/// as get(), for the cache which hands out non-const pointers
+	boost::shared_ptr<MVAComputer>
+	share(const Calibration::MVAComputerContainer *container,
+	      const char *calib);
+	boost::shared_ptr<MVAComputer>
+	share(const Calibration::MVAComputer *computer);
+
+	MVAComputerRegistry() {}
+	MVAComputerRegistry(const MVAComputerRegistry &orig);
+	MVAComputerRegistry &operator = (const MVAComputerRegistry &orig);
+
+	struct Key {
+		Key(bool container, unsigned long cacheId,
+		    const std::string &label) :
+			container(container), cacheId(cacheId), label(label) {}
+
+		bool operator < (const Key &other) const
+		{
+			if (cacheId != other.cacheId)
+				return cacheId < other.cacheId;
+			if (container != other.container)
+				return container < other.container;
+			return label < other.label;
+		}
+
+		bool		container;
+		unsigned long	cacheId;
+		std::string	label;
+	};
+
+	typedef std::map<Key, boost::weak_ptr<MVAComputer> > Map;
+
+	boost::shared_ptr<MVAComputer>
+	share(const Key &key, const Calibration::MVAComputer *computer);
+
+	Map				computers;
+	mutable boost::mutex		mutex;
+};
+
+} // namespace PhysicsTools
+
+#endif // PhysicsTools_MVAComputer_MVAComputerRegistry_h
@@ -14,6 +14,7 @@
 
 #include <functional>
 #include <algorithm>
+#include <iterator>
 #include <numeric>
 #include <cstring>
 #include <string>
@@ -23,6 +24,7 @@
 #include <boost/bind.hpp>
 
 #include "FWCore/Framework/interface/EventSetup.h"
+#include "FWCore/Utilities/interface/Exception.h"
 
 #include "PhysicsTools/MVAComputer/interface/AtomicId.h"
 #include "PhysicsTools/MVAComputer/interface/Calibration.h"
@@ -38,14 +40,35 @@ namespace PhysicsTools {
  * Simply calls a "double compute(const AtomicID &name) const" method
  * on the object for each variable requested.
  *
+ * If the object type provides a static method
+ * "double (*resolve(const AtomicId &name))(const Object&)", the
+ * variable name is resolved once when the filler is constructed and
+ * the returned accessor is called directly for every object instead.
+ * A null accessor falls back to compute().
+ *
  ************************************************************/
 template<typename Object>
 struct MVAModuleHelperDefaultFiller {
-	MVAModuleHelperDefaultFiller(const PhysicsTools::AtomicId &name) {}
+	typedef double (*Accessor)(const Object &object);
+
+	MVAModuleHelperDefaultFiller(const PhysicsTools::AtomicId &name) :
+		accessor(resolve<Object>(name, 0)) {}
 
 	double operator()(const Object &object,
-	                  const PhysicsTools::AtomicId &name)
-	{ return object.compute(name); }
+	                  const PhysicsTools::AtomicId &name) const
+	{ return accessor ? accessor(object) : object.compute(name); }
+
+    private:
+	template<typename T>
+	static Accessor resolve(const PhysicsTools::AtomicId &name,
+	                        decltype(&T::resolve))
+	{ return T::resolve(name); }
+
+	template<typename T>
+	static Accessor resolve(const PhysicsTools::AtomicId &name, ...)
+	{ return 0; }
+
+	Accessor	accessor;
 };
 
 /** \class MVAModuleHelper
@@ -55,15 +78,30 @@ struct MVAModuleHelperDefaultFiller {
  * The class MVAModuleHelper can be embedded in EDM modules.  It automatically
  * collects the variables listed in the MVA training description using type
  * traits and passes them on to the computer.  The calibration and or trainer
- * is automatically collected from the EventSetup.
+ * is automatically collected from the EventSetup. With the cache mode
+ * kShared the computer instance is shared with all other modules using
+ * the same calibration.
+ *
+ * After setEventSetup the helper is not modified by the evaluation,
+ * every call fills its own input frame on the stack, so objects can be
+ * evaluated concurrently as long as the Filler can.
+ *
+ * operator() passes every value of the Filler on unchanged. In the
+ * batch and lazy evaluation a NaN marks an absent optional value.
+ * Training skips objects with non-finite values.
+ * Evaluating without a calibration throws a cms::Exception.
  *
  ************************************************************/
 template<class Record, typename Object,
          class Filler = MVAModuleHelperDefaultFiller<Object> >
 class MVAModuleHelper {
     public:
-	MVAModuleHelper(const std::string &label) : label(label) {}
-	MVAModuleHelper(const MVAModuleHelper &orig) : label(orig.label) {}
+	MVAModuleHelper(const std::string &label,
+	                PhysicsTools::MVAComputerCache::Mode mode =
+				PhysicsTools::MVAComputerCache::kSynchronous) :
+		label(label), cache(mode) {}
+	MVAModuleHelper(const MVAModuleHelper &orig) :
+		label(orig.label), cache(orig.cache.getMode()) {}
 	~MVAModuleHelper() {}
 
 	void setEventSetup(const edm::EventSetup &setup);
@@ -71,11 +109,21 @@ class MVAModuleHelper {
 
 	double operator()(const Object &object) const;
 
+	/// evaluate the objects in range \a first to \a last with one batch call
+	template<typename Iterator>
+	std::vector<double> operator()(Iterator first, Iterator last) const;
+
+	/// evaluate, calling the Filler only for variables the computation reads
+	double evalLazy(const Object &object) const;
+
 	void train(const Object &object, bool target, double weight = 1.0) const;
 
     private:
 	void init(const PhysicsTools::Calibration::MVAComputerContainer *container);
 
+	/// current computer, throws if there is none to evaluate with
+	PhysicsTools::MVAComputerCache::Handle computer() const;
+
 	const std::string		label;
 	PhysicsTools::MVAComputerCache	cache;
 
@@ -83,26 +131,37 @@ class MVAModuleHelper {
 	    public:
 	    	Value(const std::string &name) :
 	    		name(name), filler(name) {}
-	    	Value(const std::string &name, double value) :
-			name(name), filler(name), value(value) {}
 
-		inline bool update(const Object &object) const
-		{
-			value = filler(object, name);
-			return !std::isfinite(value);
-		}
+		inline double compute(const Object &object) const
+		{ return filler(object, name); }
 
 		PhysicsTools::AtomicId getName() const { return name; }
-		double getValue() const { return value; }
 
 	    private:
 		PhysicsTools::AtomicId		name;
 		Filler				filler;
+	};
+
+	/// per-call input frame, on the stack unless there are many inputs
+	enum { kFrameSize = 64 };
+
+	template<class List>
+	bool fill(const Object &object, List &list) const;
 
-		mutable double			value;
+	/// computes the variables of one object on request of the computer
+	struct Source : public PhysicsTools::MVAComputer::InputSource {
+		Source(const std::vector<Value> &values, const Object &object) :
+			values(values), object(object) {}
+
+		double value(unsigned int i) const
+		{ return values[i].compute(object); }
+
+		const std::vector<Value>	&values;
+		const Object			&object;
 	};
 
 	std::vector<Value>			values;
+	std::vector<PhysicsTools::AtomicId>	names;
 };
 
 template<class Record, typename Object, class Filler>
@@ -134,45 +193,107 @@ void MVAModuleHelper<Record, Object, Filler>::init(
 	const std::vector<PhysicsTools::Calibration::Variable> &vars =
 					container->find(label).inputSet;
 	values.clear();
+	names.clear();
 	for(std::vector<PhysicsTools::Calibration::Variable>::const_iterator
-			iter = vars.begin(); iter != vars.end(); ++iter)
-		if (std::strncmp(iter->name.c_str(), "__", 2) != 0)
+			iter = vars.begin(); iter != vars.end(); ++iter) {
+		if (std::strncmp(iter->name.c_str(), "__", 2) != 0) {
 			values.push_back(Value(iter->name));
+			names.push_back(values.back().getName());
+		}
+	}
+}
+
+template<class Record, typename Object, class Filler>
+template<class List>
+bool MVAModuleHelper<Record, Object, Filler>::fill(
+				const Object &object, List &list) const
+{
+	bool finite = true;
+	for(typename std::vector<Value>::const_iterator iter = values.begin();
+	    iter != values.end(); ++iter) {
+		double value = iter->compute(object);
+		finite = finite && std::isfinite(value);
+		list.add(iter->getName(), value);
+	}
+
+	return finite;
 }
 
 template<class Record, typename Object, class Filler>
 double MVAModuleHelper<Record, Object, Filler>::operator()(
 						const Object &object) const
 {
-	std::for_each(values.begin(), values.end(),
-	              boost::bind(&Value::update, _1, object));
-	return cache->eval(values);
+	PhysicsTools::AtomicId ids[kFrameSize];
+	double frame[kFrameSize];
+	PhysicsTools::Variable::ValueColumns list(ids, frame, kFrameSize);
+	fill(object, list);
+
+	// keeps the computer alive across a concurrent update
+	return computer()->eval(list);
 }
 
 template<class Record, typename Object, class Filler>
-void MVAModuleHelper<Record, Object, Filler>::train(
-		const Object &object, bool target, double weight) const
+PhysicsTools::MVAComputerCache::Handle
+MVAModuleHelper<Record, Object, Filler>::computer() const
 {
-	static const PhysicsTools::AtomicId kTargetId("__TARGET__");
-	static const PhysicsTools::AtomicId kWeightId("__WEIGHT__");
+	PhysicsTools::MVAComputerCache::Handle result = cache.handle();
+	if (!result)
+		throw cms::Exception("NoComputerAvailable")
+			<< "No MVAComputer for \"" << label << "\" available, "
+			   "setEventSetup needs to be called first." << std::endl;
 
-	if (!cache)
-		return;
+	return result;
+}
+
+// the inputs are filled variable by variable into one column each,
+// a NaN from the Filler marks an absent optional value
+
+template<class Record, typename Object, class Filler>
+template<typename Iterator>
+std::vector<double> MVAModuleHelper<Record, Object, Filler>::operator()(
+				Iterator first, Iterator last) const
+{
+	unsigned int n = std::distance(first, last);
+	std::vector<double> results(n);
+	if (!n)
+		return results;
+
+	std::vector<double> block(n * values.size());
+	std::vector<const double*> columns(values.size());
+	for(unsigned int i = 0; i < values.size(); i++) {
+		double *column = &block[i * n];
+		columns[i] = column;
+		for(Iterator iter = first; iter != last; ++iter)
+			*column++ = values[i].compute(*iter);
+	}
+
+	computer()->eval(names, columns, n, &results.front());
+
+	return results;
+}
+
+template<class Record, typename Object, class Filler>
+double MVAModuleHelper<Record, Object, Filler>::evalLazy(
+						const Object &object) const
+{
+	return computer()->evalLazy(names, Source(values, object));
+}
 
-	using boost::bind;
-	if (std::accumulate(values.begin(), values.end(), 0,
-	                    bind(std::plus<int>(), _1,
-	                         bind(&Value::update, _2, object))))
+template<class Record, typename Object, class Filler>
+void MVAModuleHelper<Record, Object, Filler>::train(
+		const Object &object, bool target, double weight) const
+{
+	PhysicsTools::MVAComputerCache::Handle trainer = cache.handle();
+	if (!trainer)
 		return;
 
 	PhysicsTools::Variable::ValueList list;
-	list.add(kTargetId, target);
-	list.add(kWeightId, weight);
-	for(typename std::vector<Value>::const_iterator iter = values.begin();
-	    iter != values.end(); ++iter)
-		list.add(iter->getName(), iter->getValue());
+	list.add(MVA_ATOMIC_ID("__TARGET__"), target);
+	list.add(MVA_ATOMIC_ID("__WEIGHT__"), weight);
+	if (!fill(object, list))
+		return;
 
-	cache->eval(list);
+	trainer->eval(list);
 }
 
 } // namespace PhysicsTools
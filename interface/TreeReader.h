@@ -9,6 +9,7 @@
 
 #include <TTree.h>
 #include <TBranch.h>
+#include <TLeaf.h>
 
 #include "PhysicsTools/MVAComputer/interface/AtomicId.h"
 #include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
@@ -46,12 +47,64 @@ class TreeReader {
 	void reset();
 	void update();
 
+	/// drop the variables \a mva does not read (with \a usedOnly also those only read by processors it skips) and disable their branches, returns the branches still read
+	std::vector<std::string> prune(const MVAComputer *mva,
+	                               bool usedOnly = true);
+
+	/// names of the branches bound to variables
+	std::vector<std::string> branches() const;
+
+	/// read the branches through a tree cache of \a size bytes holding only them, with \a prefetch the cache of each file of the tree prefetches asynchronously
+	void setCache(Long64_t size = 30000000, bool prefetch = false);
+
+	/// bytes read from the files of the tree since the last update(), including those of the workers of parallel loops
+	Long64_t bytesRead() const;
+
+	/// read calls issued to the files of the tree since the last update(), including those of parallel loops
+	Int_t readCalls() const;
+
 	uint64_t loop(const MVAComputer *mva);
 
+	/// evaluate on \a nThreads threads, one if \a mva is not thread safe; trees not read from a file (or with such friends) are evaluated serially on the calling thread
+	uint64_t loop(const MVAComputer *mva, std::vector<double> &results,
+	              unsigned int nThreads = 0);
+
+	/// read entries on \a nReaders threads into a bounded ring of blocks of \a blockSize entries that \a nEvaluators threads evaluate; like loop() trees not read from a file are evaluated serially
+	uint64_t loopPipelined(const MVAComputer *mva,
+	                       std::vector<double> &results,
+	                       unsigned int nReaders = 0,
+	                       unsigned int nEvaluators = 0,
+	                       unsigned int blockSize = 256);
+
+	/// evaluate tree \a treeName in each of \a files, several files at a time on \a nThreads threads, results in the order of the files
+	uint64_t loopFiles(const MVAComputer *mva, const char *treeName,
+	                   const std::vector<std::string> &files,
+	                   std::vector<double> &results,
+	                   unsigned int nThreads = 0);
+
+	/// evaluate the files of the chain set as tree file by file in parallel, throws for chains with friend trees
+	uint64_t loopFiles(const MVAComputer *mva,
+	                   std::vector<double> &results,
+	                   unsigned int nThreads = 0);
+
+	uint64_t loopColumns(const MVAComputer *mva,
+	                     std::vector<double> &results,
+	                     unsigned int blockSize = 4096);
+
+	uint64_t loop(const MVAComputer *mva, TTree *output,
+	              const char *branchName, bool derivatives = false,
+	              Int_t bufSize = 32000);
+
 	double fill(const MVAComputer *mva);
 
+	/// read \a entry, growing the C array buffers first if a chain moves on to a tree with longer arrays
+	Int_t getEntry(Long64_t entry);
+
 	Variable::ValueList fill();
 
+	/// values of the current entry filled in place, valid until the next fill
+	const Variable::ValueColumns &fillColumns();
+
 	std::vector<AtomicId> variables() const;
 
 	static const double	kOptVal;
@@ -74,13 +127,82 @@ class TreeReader {
 	std::vector<Float_t>		singleFloat;
 	std::vector<Int_t>		singleInt;
 	std::vector<Bool>		singleBool;
+	std::vector<Short_t>		singleShort;
+	std::vector<UInt_t>		singleUInt;
+	std::vector<Long64_t>		singleLong64;
+	std::vector<UChar_t>		singleUChar;
+
+	/// buffer of a C array branch "x[n]/F" or "x[3]/F"
+	struct Array {
+		inline Array() : length(1), capacity(0), count(0), countPtr(0) {}
+
+		/// name of the counter branch, empty for fixed size arrays
+		TString			counter;
+		/// static length per counter unit
+		unsigned int		length;
+		/// elements the buffer holds, enough for the current tree
+		unsigned int		capacity;
+		/// counter value, unless bound to a counter variable
+		Int_t			count;
+		const Int_t		*countPtr;
+		/// element storage, Long64_t for alignment
+		std::vector<Long64_t>	data;
+	};
+
+	std::vector<Array>		arrays;
+
+	/// typed copy of one variable from its buffer into the value list
+	struct FillOp {
+		typedef void (*Function)(const FillOp &op,
+		                         Variable::ValueColumns &values);
+		typedef double (*Read)(const FillOp &op);
+		typedef void (*Unpack)(const FillOp &op, const char *buffer,
+		                       Long64_t skip, Long64_t n,
+		                       double *column);
+
+		template<typename T>
+		static void fillSingle(const FillOp &op,
+		                       Variable::ValueColumns &values);
+		template<typename T>
+		static void fillOptional(const FillOp &op,
+		                         Variable::ValueColumns &values);
+		template<typename T>
+		static void fillMulti(const FillOp &op,
+		                      Variable::ValueColumns &values);
+		template<typename T>
+		static void fillArray(const FillOp &op,
+		                      Variable::ValueColumns &values);
+		template<typename T>
+		static double read(const FillOp &op);
+		template<typename T>
+		static void unpack(const FillOp &op, const char *buffer,
+		                   Long64_t skip, Long64_t n, double *column);
+		template<typename T>
+		void bind(bool multiple, bool optional);
+		template<typename T>
+		void bindArray();
+
+		Function	function;
+		Read		value;
+		/// column from a serialized basket, null if not supported
+		Unpack		bulk;
+		AtomicId	name;
+		const void	*source;
+		const Int_t	*count;
+		unsigned int	length;
+		unsigned int	capacity;
+		bool		optional;
+		double		optVal;
+	};
 
 	class Value {
 	    public:
 		Value() {}
-		Value(int index, bool multiple, bool optional, char type) :
+		Value(int index, bool multiple, bool optional, char type,
+		      bool array = false) :
 			index(index), optional(optional), multiple(multiple),
-			optVal(TreeReader::kOptVal), type(type), ptr(0) {}
+			array(array), optVal(TreeReader::kOptVal), type(type),
+			ptr(0) {}
 		~Value() {}
 
 		void setOpt(bool opt, double optVal)
@@ -90,14 +212,22 @@ class TreeReader {
 		void setPtr(const void *ptr)
 		{ this->ptr = ptr; }
 
+		bool external() const { return ptr; }
+		bool isMultiple() const { return multiple; }
+		bool isArray() const { return array; }
+		int getIndex() const { return index; }
+		char getType() const { return type; }
+		const TString &getBranchName() const { return name; }
+
 		void update(TreeReader *reader) const;
-		void fill(AtomicId name, TreeReader *reader) const;
+		FillOp compile(AtomicId name, TreeReader *reader) const;
 
 	    private:
 		TString		name;
 		int		index;
 		bool		optional;
 		bool		multiple;
+		bool		array;
 		double		optVal;
 		char		type;
 		const void	*ptr;
@@ -105,9 +235,52 @@ class TreeReader {
 
 	friend class Value;
 
+	class Worker;
+	friend class Worker;
+
+	class Producer;
+	friend class Producer;
+
+	class FileWorker;
+	friend class FileWorker;
+
+	void prepareThreads() const;
+	uint64_t loopSerial(const MVAComputer *mva,
+	                    std::vector<double> &results);
+
+	std::vector<Long64_t> clusters() const;
+
+	void addArray(AtomicId name, char type, TLeaf *leaf);
+	void updateCounters();
+	void treeChanged();
+	void account();
+	void account(const TreeReader &worker);
+	void enablePrefetching();
+
+	void compile();
+	void fillValues();
+
 	std::map<AtomicId, Value>	valueMap;
-	Variable::ValueList		values;
+	std::vector<FillOp>		plan;
+	Variable::ValueColumns		values;
 	bool				upToDate;
+	bool				planned;
+	bool				pruned;
+	/// branches of the variables dropped by prune()
+	std::vector<TString>		prunedBranches;
+	Int_t				treeNumber;
+	Long64_t			cacheSize;
+	bool				prefetch;
+	/// read counters of the current file at update() or when opened
+	Int_t				statTree;
+	Long64_t			statBytes;
+	Int_t				statReads;
+	/// counters of the current file when last looked at
+	Long64_t			seenBytes;
+	Int_t				seenReads;
+	/// files done with and worker readers
+	Long64_t			bytesDone;
+	Int_t				readsDone;
 };
 
 #define TREEREADER_ADD_IMPL(T) \
@@ -124,6 +297,17 @@ TREEREADER_ADD_IMPL(Bool_t)
 
 #undef TREEREADER_ADD_IMPL
 
+#define TREEREADER_ADD_IMPL(T) \
+template<> \
+void TreeReader::addSingle<T>(AtomicId name, const T *value, bool opt);
+
+TREEREADER_ADD_IMPL(Short_t)
+TREEREADER_ADD_IMPL(UInt_t)
+TREEREADER_ADD_IMPL(Long64_t)
+TREEREADER_ADD_IMPL(UChar_t)
+
+#undef TREEREADER_ADD_IMPL
+
 } // namespace PhysicsTools
 
 #endif // PhysicsTools_MVAComputer_TreeReader_h
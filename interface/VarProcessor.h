@@ -49,12 +49,17 @@ class VarProcessor :
 	 *
 	 ************************************************************/
 	struct Config {
-		inline Config() : mask(Variable::FLAG_NONE), origin(0) {}
+		inline Config() :
+			mask(Variable::FLAG_NONE), origin(0),
+			declared(Variable::FLAG_ALL) {}
 		inline Config(Variable::Flags mask, unsigned int origin) :
-			mask(mask), origin(origin) {}
+			mask(mask), origin(origin), declared(mask) {}
 
 		Variable::Flags	mask;
 		unsigned int	origin;
+
+		/// flags as guaranteed by the producer of the variable
+		Variable::Flags	declared;
 	};
 
 	class ConfigCtx {
@@ -97,8 +102,9 @@ class VarProcessor :
 	eval(double *input, int *conf, double *output, int *outConf,
 	     int *loop, unsigned int offset) const
 	{
-		ValueIterator iter(inputVars.iter(), input, conf,
-		                   output, outConf, loop, offset);
+		ValueIterator iter(inputIndices.data(), nInputVars, input, conf,
+		                   output, outConf, singleValued ? 0 : loop,
+		                   offset);
 		eval(iter, nInputVars);
 	}
 
@@ -114,6 +120,19 @@ class VarProcessor :
 	                        unsigned int &nOffset) const
 	{ return kStop; }
 
+	/// processor keeps no references into its calibration object and
+	/// can be taken over by a computer built from identical calibration
+	virtual bool reusable() const { return false; }
+
+	/// eval() may be called by several threads at the same time
+	virtual bool threadSafe() const { return true; }
+
+	/// every output depending on input \a input is zero whenever input
+	/// \a gate is zero (positions among the inputs of this processor),
+	/// processors only feeding \a input can then be skipped
+	virtual bool gates(unsigned int input, unsigned int gate) const
+	{ return false; }
+
    //used to create a PluginFactory
 	struct Dummy {};
    typedef Dummy* PluginFunctionPrototype();
@@ -144,7 +163,11 @@ class VarProcessor :
 
 		/// add a new output variable that inherits values from \a origin
 		ConfIterator &operator << (const ConfIterator &origin)
-		{ return *this << Config(config[origin.cur()].mask, origin.cur()); }
+		{
+			Config config_(config[origin.cur()].mask, origin.cur());
+			config_.declared = config[origin.cur()].declared;
+			return *this << config_;
+		}
 
 		/// return the current input variable flags
 		Variable::Flags operator * () const
@@ -218,15 +241,15 @@ class VarProcessor :
 		{ *this << value; (*this)(); }
 
 		/// test for end of input variable iterator
-		inline operator bool() const { return cur; }
+		inline operator bool() const { return cur < last; }
 
 		/// move to next input variable
 		ValueIterator &operator ++ ()
 		{
-			BitSet::size_t orig = cur();
-			if (++cur) {
+			unsigned int orig = *cur;
+			if (++cur < last) {
 				unsigned int prev = *conf;
-				conf += cur() - orig; 
+				conf += *cur - orig;
 				values += *conf - prev;
 				if (loop && conf >= loop) {
 					values += offset;
@@ -243,14 +266,17 @@ class VarProcessor :
 	    protected:
 		friend class VarProcessor;
 
-		ValueIterator(BitSet::Iterator cur, double *values,
-		              int *conf, double *output, int *outConf,
-		              int *loop, unsigned int offset) :
-			cur(cur), offset(offset), start(values + offset),
-			values(values), conf(conf), loop(loop),
-			output(output + offset), outConf(outConf)
+		ValueIterator(const unsigned int *cur, unsigned int n,
+		              double *values, int *conf, double *output,
+		              int *outConf, int *loop, unsigned int offset) :
+			cur(cur), last(cur + n), offset(offset),
+			start(values + offset), values(values), conf(conf),
+			loop(loop), output(output + offset), outConf(outConf)
 		{
-			this->conf += cur();
+			if (!n)
+				return;
+
+			this->conf += *cur;
 			this->values += *this->conf;
 			if (loop && this->conf >= loop) {
 				this->values += offset;
@@ -259,7 +285,8 @@ class VarProcessor :
 		}
 
 	    private:
-		BitSet::Iterator	cur;
+		const unsigned int	*cur;
+		const unsigned int	*last;
 		const unsigned int	offset;
 		double			*const start;
 		double			*values;
@@ -296,9 +323,18 @@ class VarProcessor :
 	const MVAComputer	*computer;
 
     private:
+	friend class MVAComputer;
+
 	/// bit set to select the input variables to be passed to this processor
 	BitSet			inputVars;
 	unsigned int		nInputVars;
+
+	/// indices of the set bits in inputVars, walked during evaluation
+	std::vector<unsigned int> inputIndices;
+
+	/// every input carries exactly one value and lies outside of loops,
+	/// the value iterator then skips the multiplicity bookkeeping
+	bool			singleValued;
 };
 
 template<>
@@ -12,6 +12,8 @@
 // $Id: Variable.h,v 1.7 2007/12/08 20:22:57 saout Exp $
 //
 
+#include <algorithm>
+#include <cstddef>
 #include <vector>
 #include <string>
 
@@ -135,6 +137,105 @@ class Variable {
 		std::vector<Value>	data_;
 	};
 
+	/** \class ValueColumns
+	 *
+	 * \short Columnar list of identifier-value pairs
+	 *
+	 * Variable::ValueColumns keeps the identifiers and the values of
+	 * the list in two separate arrays, so that the evaluation can scan
+	 * the identifiers without touching the values. Clearing the list
+	 * keeps the capacity, so a list refilled for every entry stops
+	 * allocating after the first few entries. Optionally the arrays
+	 * can be placed in caller-provided storage (e.g. an arena or a
+	 * stack buffer), the list only falls back to the heap when that
+	 * storage is exhausted.
+	 *
+	 ************************************************************/
+	class ValueColumns {
+	    public:
+		typedef std::size_t		size_type;
+
+		inline ValueColumns() :
+			ids_(0), values_(0), size_(0), capacity_(0) {}
+		inline explicit ValueColumns(size_type capacity) :
+			ids_(0), values_(0), size_(0), capacity_(0)
+		{ reserve(capacity); }
+		inline ValueColumns(AtomicId *ids, double *values,
+		                    size_type capacity) :
+			ids_(ids), values_(values), size_(0),
+			capacity_(capacity) {}
+		inline ValueColumns(const ValueColumns &orig) :
+			ids_(0), values_(0), size_(0), capacity_(0)
+		{ *this = orig; }
+		inline ~ValueColumns() {}
+
+		inline ValueColumns &operator = (const ValueColumns &orig)
+		{
+			if (this == &orig)
+				return *this;
+
+			size_ = 0;
+			reserve(orig.size_);
+			std::copy(orig.ids_, orig.ids_ + orig.size_, ids_);
+			std::copy(orig.values_, orig.values_ + orig.size_,
+			          values_);
+			size_ = orig.size_;
+			return *this;
+		}
+
+		inline void clear() { size_ = 0; }
+
+		inline void reserve(size_type n)
+		{ if (n > capacity_) grow(n); }
+
+		inline void add(AtomicId id, double value)
+		{
+			if (size_ == capacity_)
+				grow(std::max<size_type>(2 * capacity_, 16));
+			ids_[size_] = id;
+			values_[size_++] = value;
+		}
+
+		inline void add(const Value &value)
+		{ add(value.getName(), value.getValue()); }
+
+		inline size_type size() const { return size_; }
+		inline size_type capacity() const { return capacity_; }
+		bool empty() const { return !size_; }
+
+		inline const AtomicId *ids() const { return ids_; }
+		inline const double *values() const { return values_; }
+		double *values() { return values_; }
+
+		inline AtomicId getName(size_type i) const { return ids_[i]; }
+		inline double getValue(size_type i) const
+		{ return values_[i]; }
+		inline void setValue(size_type i, double value)
+		{ values_[i] = value; }
+
+	    private:
+		/// move both columns to owned storage of capacity \a n
+		void grow(size_type n)
+		{
+			std::vector<AtomicId> ids(n);
+			std::vector<double> values(n);
+			std::copy(ids_, ids_ + size_, ids.begin());
+			std::copy(values_, values_ + size_, values.begin());
+			idStore_.swap(ids);
+			valueStore_.swap(values);
+			ids_ = &idStore_.front();
+			values_ = &valueStore_.front();
+			capacity_ = n;
+		}
+
+		AtomicId		*ids_;
+		double			*values_;
+		size_type		size_;
+		size_type		capacity_;
+		std::vector<AtomicId>	idStore_;
+		std::vector<double>	valueStore_;
+	};
+
 	inline Variable() {}
 	inline Variable(const Variable &orig) :
 		name(orig.name), flags(orig.flags) {}
@@ -53,6 +53,8 @@ class ProcTMVA : public VarProcessor {
 
 	virtual void configure(ConfIterator iter, unsigned int n);
 	virtual void eval(ValueIterator iter, unsigned int n) const;
+	// the TMVA reader evaluates through per-instance event buffers
+	virtual bool threadSafe() const { return false; }
 
     private:
   std::auto_ptr<TMVA::Reader>     reader;
@@ -1,57 +1,188 @@
 #include <algorithm>
+#include <cassert>
 #include <cstdlib>
 #include <cstddef>
 #include <cstring>
-#include <set>
+#include <vector>
+#include <atomic>
 
 #include <boost/thread.hpp>
 
 #include "PhysicsTools/MVAComputer/interface/AtomicId.h"
 
 namespace { // anonymous
-	struct StringLess {
-		bool operator()(const char *id1, const char *id2) const
-		{ return std::strcmp(id1, id2) < 0; }
-	};
-
+	/*
+	 * Read-mostly interning table. Lookups of known strings are
+	 * lock-free: they only load the current open-addressing table and
+	 * the slots with acquire semantics. Inserts are serialized by a
+	 * mutex. The unique strings live in an append-only arena and are
+	 * prefixed by their hash value and a dense serial number (see
+	 * AtomicId::serial), they never move or go away. When
+	 * the table fills up, a larger copy is published and the old
+	 * table is kept around, since concurrent readers might still scan
+	 * it. A reader that misses an entry only present in a newer table
+	 * simply takes the locked path and finds it there.
+	 */
 	class IdCache {
 	    public:
+		IdCache();
 		~IdCache();
 
-		inline const char *findOrInsert(const char *string) throw();
+		typedef unsigned int Hash_t;
 
-	    private:
-		typedef std::multiset<const char *, StringLess> IdSet;
+		static inline Hash_t hash(const char *string);
+
+		inline const char *findOrInsert(const char *string,
+		                                Hash_t hash) throw();
 
-		IdSet				idSet;
-		static std::allocator<char>	stringAllocator;
+	    private:
+		struct Table {
+			Table(std::size_t size) :
+				mask(size - 1), used(0),
+				slots(new std::atomic<const char*>[size])
+			{
+				for(std::size_t i = 0; i < size; i++)
+					slots[i].store(0, std::memory_order_relaxed);
+			}
+
+			~Table() { delete[] slots; }
+
+			const std::size_t		mask;
+			std::size_t			used;
+			std::atomic<const char*>	*slots;
+		};
+
+		static inline Hash_t hashOf(const char *unique)
+		{ return reinterpret_cast<const Hash_t*>(unique)[-2]; }
+
+		static const char *find(const Table *table, const char *string,
+		                        Hash_t hash) throw();
+		static void insert(Table *table, const char *unique, Hash_t hash);
+
+		const char *allocate(const char *string, std::size_t size,
+		                     Hash_t hash);
+
+		static const std::size_t	initialSize = 1024;
+		static const std::size_t	arenaSize = 64 * 1024;
+
+		std::atomic<Table*>		table;
+		std::vector<Table*>		tables;
+		std::vector<char*>		arena;
+		std::size_t			arenaUsed;
+		unsigned int			serials;
 		mutable boost::mutex		mutex;
 	};
 } // anonymous namespace
 
-std::allocator<char> IdCache::stringAllocator;
+IdCache::IdCache() :
+	table(new Table(initialSize)), arenaUsed(arenaSize), serials(0)
+{
+	tables.push_back(table.load(std::memory_order_relaxed));
+}
 
 IdCache::~IdCache()
 {
-	for(std::multiset<const char*, StringLess>::iterator iter =
-	    idSet.begin(); iter != idSet.end(); iter++)
-		stringAllocator.deallocate(const_cast<char*>(*iter),
-		                           std::strlen(*iter));
+	for(std::vector<Table*>::iterator iter = tables.begin();
+	    iter != tables.end(); ++iter)
+		delete *iter;
+	for(std::vector<char*>::iterator iter = arena.begin();
+	    iter != arena.end(); ++iter)
+		delete[] *iter;
 }
 
-const char *IdCache::findOrInsert(const char *string) throw()
+IdCache::Hash_t IdCache::hash(const char *string)
 {
-	boost::mutex::scoped_lock scoped_lock(mutex);
+	// FNV-1a, must match the constexpr AtomicId::hash
+	Hash_t hash = 2166136261U;
+	for(const char *p = string; *p; p++)
+		hash = (hash ^ (unsigned char)*p) * 16777619U;
+
+	return hash;
+}
 
-	IdSet::iterator pos = idSet.lower_bound(string);
-	if (pos != idSet.end() && std::strcmp(*pos, string) == 0)
-		return *pos;
+const char *IdCache::find(const Table *table, const char *string,
+                          Hash_t hash) throw()
+{
+	for(std::size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+		const char *unique =
+			table->slots[i].load(std::memory_order_acquire);
+		if (!unique)
+			return 0;
+		if (hashOf(unique) == hash && std::strcmp(unique, string) == 0)
+			return unique;
+	}
+}
+
+void IdCache::insert(Table *table, const char *unique, Hash_t hash)
+{
+	std::size_t i = hash & table->mask;
+	while(table->slots[i].load(std::memory_order_relaxed))
+		i = (i + 1) & table->mask;
 
-	std::size_t size = std::strlen(string) + 1;
-	char *unique = stringAllocator.allocate(size);
+	table->slots[i].store(unique, std::memory_order_release);
+	table->used++;
+}
+
+const char *IdCache::allocate(const char *string, std::size_t size,
+                              Hash_t hash)
+{
+	std::size_t bytes = 2 * sizeof(Hash_t) + size;
+	bytes = (bytes + sizeof(Hash_t) - 1) & ~(sizeof(Hash_t) - 1);
+
+	char *block;
+	if (bytes > arenaSize / 4) {
+		// large strings get a block of their own
+		block = new char[bytes];
+		arena.insert(arena.begin(), block);
+	} else {
+		if (arenaUsed + bytes > arenaSize) {
+			arena.push_back(new char[arenaSize]);
+			arenaUsed = 0;
+		}
+		block = arena.back() + arenaUsed;
+		arenaUsed += bytes;
+	}
+
+	reinterpret_cast<Hash_t*>(block)[0] = hash;
+	reinterpret_cast<unsigned int*>(block)[1] = ++serials;
+	char *unique = block + 2 * sizeof(Hash_t);
 	std::memcpy(unique, string, size);
 
-	idSet.insert(pos, unique);
+	return unique;
+}
+
+const char *IdCache::findOrInsert(const char *string, Hash_t hash) throw()
+{
+	const char *unique =
+		find(table.load(std::memory_order_acquire), string, hash);
+	if (unique)
+		return unique;
+
+	boost::mutex::scoped_lock scoped_lock(mutex);
+
+	// the table cannot change anymore while we hold the lock
+	Table *current = table.load(std::memory_order_relaxed);
+	unique = find(current, string, hash);
+	if (unique)
+		return unique;
+
+	unique = allocate(string, std::strlen(string) + 1, hash);
+
+	// keep the load factor below one half
+	if (2 * (current->used + 1) > current->mask + 1) {
+		Table *grown = new Table(2 * (current->mask + 1));
+		for(std::size_t i = 0; i <= current->mask; i++) {
+			const char *entry = current->slots[i].load(
+						std::memory_order_relaxed);
+			if (entry)
+				insert(grown, entry, hashOf(entry));
+		}
+
+		insert(grown, unique, hash);
+		tables.push_back(grown);
+		table.store(grown, std::memory_order_release);
+	} else
+		insert(current, unique, hash);
 
 	return unique;
 }
@@ -67,9 +198,17 @@ static IdCache &getAtomicIdCache()
 const char *AtomicId::lookup(const char *string) throw()
 {
 	if (string)
-		return getAtomicIdCache().findOrInsert(string);
+		return getAtomicIdCache().findOrInsert(string,
+		                                       IdCache::hash(string));
 
 	return 0;
 }
 
+const char *AtomicId::lookup(const char *string, unsigned int hash) throw()
+{
+	// a wrong hash would intern the string a second time
+	assert(hash == IdCache::hash(string));
+	return getAtomicIdCache().findOrInsert(string, hash);
+}
+
 } // namespace PhysicsTools
@@ -1,3 +1,5 @@
+#include <vector>
+
 #include "PhysicsTools/MVAComputer/interface/BitSet.h"
 #include "PhysicsTools/MVAComputer/interface/Calibration.h"
 
@@ -5,36 +7,25 @@ namespace PhysicsTools {
 
 BitSet::size_t BitSet::bits() const
 {
-	static unsigned char byteBits[256] = {
-		0,  1,  1,  2,  1,  2,  2,  3,  1,  2,  2,  3,  2,  3,  3,    
-		4,  1,  2,  2,  3,  2,  3,  3,  4,  2,  3,  3,  4,  3,  4,
-		4,  5,  1,  2,  2,  3,  2,  3,  3,  4,  2,  3,  3,  4,  3,    
-		4,  4,  5,  2,  3,  3,  4,  3,  4,  4,  5,  3,  4,  4,  5,    
-		4,  5,  5,  6,  1,  2,  2,  3,  2,  3,  3,  4,  2,  3,  3,    
-		4,  3,  4,  4,  5,  2,  3,  3,  4,  3,  4,  4,  5,  3,  4,
-		4,  5,  4,  5,  5,  6,  2,  3,  3,  4,  3,  4,  4,  5,  3,
-		4,  4,  5,  4,  5,  5,  6,  3,  4,  4,  5,  4,  5,  5,  6,
-		4,  5,  5,  6,  5,  6,  6,  7,  1,  2,  2,  3,  2,  3,  3,    
-		4,  2,  3,  3,  4,  3,  4,  4,  5,  2,  3,  3,  4,  3,  4,    
-		4,  5,  3,  4,  4,  5,  4,  5,  5,  6,  2,  3,  3,  4,  3,    
-		4,  4,  5,  3,  4,  4,  5,  4,  5,  5,  6,  3,  4,  4,  5,    
-		4,  5,  5,  6,  4,  5,  5,  6,  5,  6,  6,  7,  2,  3,  3,
-		4,  3,  4,  4,  5,  3,  4,  4,  5,  4,  5,  5,  6,  3,  4,    
-		4,  5,  4,  5,  5,  6,  4,  5,  5,  6,  5,  6,  6,  7,  3,    
-		4,  4,  5,  4,  5,  5,  6,  4,  5,  5,  6,  5,  6,  6,  7,
-		4,  5,  5,  6,  5,  6,  6,  7,  5,  6,  6,  7,  6,  7,  7,    
-		8
-	};
-	unsigned char *begin = (unsigned char*)store;
-	unsigned char *end   = (unsigned char*)(store + bitsToWords(bits_));
+	const Word_t *end = store + bitsToWords(bits_);
 
 	size_t bits = 0;
-	for(unsigned char *p = begin; p < end; p++)
-		bits += byteBits[*p];
+	for(const Word_t *p = store; p < end; p++)
+		bits += __builtin_popcountll(*p);
 
 	return bits;
 }
 
+std::vector<unsigned int> BitSet::indices() const
+{
+	std::vector<unsigned int> result;
+	result.reserve(bits());
+	for(Iterator iter = this->iter(); iter; ++iter)
+		result.push_back(iter());
+
+	return result;
+}
+
 BitSet Calibration::convert(const Calibration::BitSet &bitSet)
 {
 	PhysicsTools::BitSet::size_t size = bitSet.store.size();
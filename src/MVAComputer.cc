@@ -1,3 +1,5 @@
+#include <stdlib.h>
+#include <stdint.h>
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -5,8 +7,12 @@
 #include <iterator>
 #include <cstddef>
 #include <cstring>
+#include <cmath>
+#include <typeinfo>
+#include <utility>
 #include <vector>
 #include <set>
+#include <map>
 
 // ROOT version magic to support TMVA interface changes in newer ROOT   
 #include <RVersion.h>
@@ -14,13 +20,17 @@
 #include <TBufferFile.h>
 #include <TClass.h>
 
+#include <boost/thread/mutex.hpp>
+
 #include "FWCore/Utilities/interface/Exception.h"
+#include "FWCore/Utilities/interface/Digest.h"
 
 #include "PhysicsTools/MVAComputer/interface/zstream.h"
 
 #include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
 #include "PhysicsTools/MVAComputer/interface/VarProcessor.h"
 #include "PhysicsTools/MVAComputer/interface/Calibration.h"
+#include "PhysicsTools/MVAComputer/interface/BitSet.h"
 #include "PhysicsTools/MVAComputer/interface/Variable.h"
 #include "PhysicsTools/MVAComputer/interface/AtomicId.h"
 
@@ -32,35 +42,81 @@
 
 #define STANDALONE_HEADER "MVAComputer calibration\n"
 
+// small per-call arrays on the stack, as in MVAComputer.icc
+#ifdef alloca
+#	define __TMP_ALLOC(n, type) ((type*)alloca((n) * sizeof(type)))
+#else
+#	define __TMP_ALLOC(n, type) ((type*)::alloca((n) * sizeof(type)))
+#endif
+
 namespace PhysicsTools {
 
+namespace { // anonymous
+	// digests by cache id of the calibration and processor index, a
+	// cache id is never handed out twice, so that every calibration
+	// is only streamed once however many computers are built from it
+	typedef std::map<std::pair<Calibration::MVAComputer::CacheId,
+	                           unsigned int>, cms::MD5Result> DigestCache;
+
+	boost::mutex	digestMutex;
+	DigestCache	digestCache;
+
+	const DigestCache::size_type maxDigests = 4096;
+} // anonymous namespace
+
 MVAComputer::MVAComputer(const Calibration::MVAComputer *calib) :
-	nVars(0), output(0)
+	serialBase(0), nVars(0), output(0), nReused(0)
 {
 	setup(calib);
 }
 
 MVAComputer::MVAComputer(Calibration::MVAComputer *calib, bool owned) :
-	nVars(0), output(0)
+	serialBase(0), nVars(0), output(0), nReused(0)
 {
 	if (owned)
 		this->owned.reset(calib);
 	setup(calib);
 }
 
+MVAComputer::MVAComputer(const Calibration::MVAComputer *calib,
+                         MVAComputer *previous) :
+	serialBase(0), nVars(0), output(0), nReused(0)
+{
+	std::vector<std::pair<unsigned int, unsigned int> > taken;
+	try {
+		setup(calib, previous, true, &taken);
+	} catch(...) {
+		// hand the processors back, the previous computer stays intact
+		for(std::vector<std::pair<unsigned int, unsigned int> >::
+			const_iterator iter = taken.begin();
+		    iter != taken.end(); ++iter) {
+			Processor &orig = previous->varProcessors[iter->second];
+			orig.processor.reset(
+				varProcessors[iter->first].processor.release());
+			orig.processor->computer = previous;
+		}
+		throw;
+	}
+
+	nReused = taken.size();
+}
+
 MVAComputer::MVAComputer(const char *filename) :
-	nVars(0), output(0), owned(readCalibration(filename))
+	serialBase(0), nVars(0), output(0), nReused(0), owned(readCalibration(filename))
 {
 	setup(owned.get());
 }
 
 MVAComputer::MVAComputer(std::istream &is) :
-	nVars(0), output(0), owned(readCalibration(is))
+	serialBase(0), nVars(0), output(0), nReused(0), owned(readCalibration(is))
 {
 	setup(owned.get());
 }
 
-void MVAComputer::setup(const Calibration::MVAComputer *calib)
+void MVAComputer::setup(const Calibration::MVAComputer *calib,
+                        MVAComputer *previous, bool track,
+                        std::vector<std::pair<unsigned int,
+                                              unsigned int> > *taken)
 {
 	nVars = calib->inputSet.size();
 	output = calib->output;
@@ -68,24 +124,69 @@ void MVAComputer::setup(const Calibration::MVAComputer *calib)
 	std::vector<Variable::Flags> flags(nVars, Variable::FLAG_ALL);
 	const TrainMVAComputerCalibration *trainCalib =
 		dynamic_cast<const TrainMVAComputerCalibration*>(calib);
-	if (trainCalib)
+	if (trainCalib) {
 		trainCalib->initFlags(flags);
+		// trainer calibrations are transient, never reuse them
+		track = false;
+	}
 
 	VarProcessor::ConfigCtx config(flags);
 	std::vector<Calibration::VarProcessor*> processors =
 							calib->getProcessors();
 
+	// calibrations are only digested if there is something to take over
+	bool candidates = false;
+	if (track && previous)
+		for(std::vector<Processor>::const_iterator old =
+			previous->varProcessors.begin();
+		    old != previous->varProcessors.end(); ++old)
+			if (old->processor.get() && old->digest.isValid() &&
+			    old->processor->reusable())
+				candidates = true;
+
+	unsigned int index = 0;
 	for(std::vector<Calibration::VarProcessor*>::const_iterator iter =
 							processors.begin();
-	    iter != processors.end(); ++iter) {
+	    iter != processors.end(); ++iter, index++) {
 		std::string name = (*iter)->getInstanceName();
-		VarProcessor *processor =
-			VarProcessor::create(name.c_str(), *iter, this);
+		cms::MD5Result digest;
+		if (candidates)
+			digest = MVAComputer::digest(calib, index, *iter);
+
+		// take over the processor built from identical calibration
+		VarProcessor *processor = 0;
+		if (digest.isValid()) {
+			for(std::vector<Processor>::iterator old =
+				previous->varProcessors.begin();
+			    old != previous->varProcessors.end(); ++old) {
+				if (old->processor.get() &&
+				    old->digest == digest &&
+				    old->processor->reusable()) {
+					processor = old->processor.release();
+					processor->computer = this;
+					taken->push_back(std::make_pair(
+						varProcessors.size(),
+						old - previous->varProcessors.begin()));
+					break;
+				}
+			}
+		}
+
+		if (!processor)
+			processor = VarProcessor::create(name.c_str(),
+			                                 *iter, this);
 		if (!processor)
 			throw cms::Exception("UnknownProcessor")
 				<< name << " could not be instantiated."
 				<< std::endl;
 
+		// only reusable processors are handed on to later computers
+		if (track && !digest.isValid() && processor->reusable())
+			digest = MVAComputer::digest(calib, index, *iter);
+
+		// owned from here on, also if the configuration fails
+		varProcessors.push_back(Processor(processor, 0, digest));
+
 		VarProcessor::ConfigCtx::iterator::difference_type pos =
 						config.end() - config.begin();
 		processor->configure(config);
@@ -95,7 +196,7 @@ void MVAComputer::setup(const Calibration::MVAComputer *calib)
 				<< name << " rejected input variable "
 				"configuration" << std::endl;
 
-		varProcessors.push_back(Processor(processor, nOutput));
+		varProcessors.back().nOutput = nOutput;
 	}
 
 	for(VarProcessor::ConfigCtx::iterator iter = config.begin() + nVars;
@@ -128,6 +229,7 @@ void MVAComputer::setup(const Calibration::MVAComputer *calib)
 		var.var = Variable(iter->name, config[i].mask);
 		var.index = i;
                 var.multiplicity = 0;
+		var.used = false;
 		variables.insert(var);
 	}
 
@@ -137,13 +239,203 @@ void MVAComputer::setup(const Calibration::MVAComputer *calib)
 
 	for(unsigned int j = 0; j < i; j++)
 		inputVariables[j].multiplicity = config[j].origin;
+
+	// walk the processors backwards from the output, a processor with
+	// a needed output variable needs all of its input variables
+	std::vector<bool> needed(nVars, false);
+	needed[output] = true;
+	unsigned int end = nVars;
+	for(std::vector<Processor>::reverse_iterator iter =
+		varProcessors.rbegin(); iter != varProcessors.rend(); ++iter) {
+		unsigned int begin = end - iter->nOutput;
+		iter->used = std::find(needed.begin() + begin,
+		                       needed.begin() + end, true) !=
+		             needed.begin() + end;
+		if (iter->used)
+			for(BitSet::Iterator bit =
+				iter->processor->inputVars.iter(); bit; ++bit)
+				needed[bit()] = true;
+		end = begin;
+	}
+
+	// the other processors with single-valued outputs are skipped, the
+	// remaining ones are still evaluated and read their inputs
+	unsigned int begin = inputVariables.size();
+	for(std::vector<Processor>::iterator iter = varProcessors.begin();
+	    iter != varProcessors.end(); ++iter) {
+		end = begin + iter->nOutput;
+		iter->skipped = !iter->used;
+		for(unsigned int var = begin; iter->skipped && var < end; var++)
+			if (config[var].declared != Variable::FLAG_NONE)
+				iter->skipped = false;
+
+		if (!iter->used && !iter->skipped)
+			for(BitSet::Iterator bit =
+				iter->processor->inputVars.iter(); bit; ++bit)
+				if (bit() < inputVariables.size())
+					needed[bit()] = true;
+		begin = end;
+	}
+
+	for(std::vector<InputVar>::iterator iter = inputVariables.begin();
+	    iter != inputVariables.end(); ++iter)
+		iter->used = needed[iter->index];
+
+	setupGuards(config);
+
+	// direct lookup table over the range of serial numbers in use
+	if (inputVariables.empty())
+		return;
+
+	unsigned int minSerial = ~0U, maxSerial = 0;
+	for(std::vector<InputVar>::const_iterator iter =
+		inputVariables.begin(); iter != inputVariables.end(); ++iter) {
+		unsigned int serial = iter->var.getName().serial();
+		minSerial = std::min(minSerial, serial);
+		maxSerial = std::max(maxSerial, serial);
+	}
+
+	// names interned far apart, leave it to the binary search
+	if (maxSerial - minSerial > 16 * inputVariables.size() + 1024)
+		return;
+
+	serialBase = minSerial;
+	variableSlots.assign(maxSerial - minSerial + 1, ~0U);
+	for(std::vector<InputVar>::const_iterator iter =
+		inputVariables.begin(); iter != inputVariables.end(); ++iter)
+		variableSlots[iter->var.getName().serial() - serialBase] =
+								iter->index;
+}
+
+// A processor can be skipped when a variable, the guard, is zero if each
+// consumer of its outputs either multiplies them with the guard (e.g. a
+// ProcMultiply with a ProcClassed output as factor) or is itself skipped
+// when the guard is zero. The processors are visited backwards so the
+// guards of the consumers are known. Only processors with single-valued
+// outputs outside of loops qualify, the guard has to be a single-valued
+// variable computed before the processor.
+
+void MVAComputer::setupGuards(VarProcessor::ConfigCtx &config)
+{
+	unsigned int nProcs = varProcessors.size();
+	std::vector<unsigned int> first(nProcs + 1, inputVariables.size());
+	for(unsigned int i = 0; i < nProcs; i++)
+		first[i + 1] = first[i] + varProcessors[i].nOutput;
+
+	for(unsigned int i = nProcs; i-- > 0; ) {
+		Processor &proc = varProcessors[i];
+		proc.guard = -1;
+		if (!proc.used)
+			continue;
+
+		std::vector<unsigned int> candidates;
+		bool consumed = false;
+		bool possible = true;
+		for(unsigned int var = first[i];
+		    possible && var < first[i + 1]; var++) {
+			if (var == output ||
+			    config[var].declared != Variable::FLAG_NONE) {
+				possible = false;
+				break;
+			}
+
+			for(unsigned int j = i + 1; possible && j < nProcs; j++) {
+				const Processor &consumer = varProcessors[j];
+				if (!consumer.used)
+					continue;
+
+				const std::vector<unsigned int> &inputs =
+					consumer.processor->inputIndices;
+				std::vector<unsigned int>::const_iterator pos =
+					std::lower_bound(inputs.begin(),
+					                 inputs.end(), var);
+				if (pos == inputs.end() || *pos != var)
+					continue;
+
+				std::vector<unsigned int> gates;
+				if (consumer.guard >= 0)
+					gates.push_back(consumer.guard);
+				for(unsigned int k = 0; k < inputs.size(); k++)
+					if (consumer.processor->gates(
+						pos - inputs.begin(), k))
+						gates.push_back(inputs[k]);
+				std::sort(gates.begin(), gates.end());
+
+				if (consumed) {
+					std::vector<unsigned int> common;
+					std::set_intersection(
+						candidates.begin(), candidates.end(),
+						gates.begin(), gates.end(),
+						std::back_inserter(common));
+					candidates.swap(common);
+				} else
+					candidates.swap(gates);
+
+				consumed = true;
+				possible = !candidates.empty();
+			}
+		}
+
+		if (!possible || !consumed)
+			continue;
+
+		for(std::vector<unsigned int>::const_iterator iter =
+			candidates.begin(); iter != candidates.end(); ++iter) {
+			if (*iter >= inputVariables.size() && *iter < first[i] &&
+			    config[*iter].declared == Variable::FLAG_NONE) {
+				proc.guard = *iter;
+				break;
+			}
+		}
+	}
 }
 
 MVAComputer::~MVAComputer()
 {
 }
 
-unsigned int MVAComputer::getVariableId(AtomicId name) const
+cms::MD5Result MVAComputer::digest(const Calibration::MVAComputer *calib,
+                                   unsigned int index,
+                                   const Calibration::VarProcessor *proc)
+{
+	DigestCache::key_type key(calib->getCacheId(), index);
+	{
+		boost::mutex::scoped_lock scoped_lock(digestMutex);
+		DigestCache::const_iterator pos = digestCache.find(key);
+		if (pos != digestCache.end())
+			return pos->second;
+	}
+
+	cms::MD5Result result = digest(proc);
+
+	boost::mutex::scoped_lock scoped_lock(digestMutex);
+	if (digestCache.size() >= maxDigests)
+		digestCache.clear();
+	digestCache[key] = result;
+
+	return result;
+}
+
+cms::MD5Result MVAComputer::digest(const Calibration::VarProcessor *calib)
+{
+	cms::MD5Result result;
+
+	// without dictionary the processor is simply never reused
+	TClass *rootClass = TClass::GetClass(typeid(*calib));
+	if (!rootClass)
+		return result;
+
+	TBufferFile buffer(TBuffer::kWrite);
+	buffer.StreamObject(const_cast<void*>(dynamic_cast<const void*>(calib)),
+	                    rootClass);
+
+	cms::Digest md5(rootClass->GetName());
+	md5.append(buffer.Buffer(), buffer.Length());
+
+	return md5.digest();
+}
+
+unsigned int MVAComputer::findVariableId(AtomicId name) const
 {
 	std::vector<InputVar>::const_iterator pos =
 		std::lower_bound(inputVariables.begin(), inputVariables.end(),
@@ -157,6 +449,275 @@ unsigned int MVAComputer::getVariableId(AtomicId name) const
 	return pos->index;
 }
 
+std::vector<AtomicId> MVAComputer::variables(bool usedOnly) const
+{
+	std::vector<AtomicId> result;
+	for(std::vector<InputVar>::const_iterator iter =
+		inputVariables.begin(); iter != inputVariables.end(); ++iter)
+		if (!usedOnly || iter->used)
+			result.push_back(iter->var.getName());
+
+	return result;
+}
+
+bool MVAComputer::threadSafe() const
+{
+	for(std::vector<Processor>::const_iterator iter =
+		varProcessors.begin(); iter != varProcessors.end(); ++iter)
+		if (!iter->processor->threadSafe())
+			return false;
+
+	return true;
+}
+
+// the columnar variant scans the identifier column alone first, resolving
+// each identifier only once, and then touches the value column to fill
+// the values array in a single pass
+
+double MVAComputer::eval(const Variable::ValueColumns &values) const
+{
+	unsigned int size = inputVariables.size();
+	unsigned int n = values.size();
+
+	int *conf = __TMP_ALLOC(nVars + 2, int);
+
+	unsigned int *ids = __TMP_ALLOC(n, unsigned int);
+	const AtomicId *names = values.ids();
+	for(unsigned int i = 0; i < n; i++)
+		ids[i] = getVariableId(names[i]);
+
+	unsigned int max;
+	if (isSparse(n))
+		max = sparseOffsets(conf, ids, n);
+	else {
+		std::memset(conf, 0, (nVars + 2) * sizeof(int));
+
+		max = nVars;
+		for(unsigned int i = 0; i < n; i++) {
+			conf[ids[i] + 1]++;
+			max += inputVariables[ids[i]].multiplicity + 1;
+		}
+
+		unsigned int sum = 0;
+		for(unsigned int i = 1; i <= size; i++) {
+			unsigned int tmp = conf[i];
+			conf[i] = sum;
+			sum += tmp;
+		}
+	}
+
+	double *array = __TMP_ALLOC(max - size + 1, double);
+	array[0] = 0.0;
+	const double *value = values.values();
+	for(unsigned int i = 0; i < n; i++)
+		array[conf[ids[i] + 1]++] = value[i];
+
+	EvalContext ctx(array, conf, n);
+	evalInternal(ctx);
+
+	return ctx.output(output);
+}
+
+// the batch variant resolves the columns once, every event then only
+// scatters one value per column into the values array, with the conf
+// offsets filled in runs between the columns (like the sparse path)
+
+void MVAComputer::eval(const std::vector<AtomicId> &names,
+                       const std::vector<const double*> &columns,
+                       unsigned int n, double *results) const
+{
+	unsigned int size = inputVariables.size();
+	unsigned int nColumns = names.size();
+
+	typedef std::pair<unsigned int, const double*> Column;
+	std::vector<Column> order(nColumns);
+	unsigned int max = nVars;
+	for(unsigned int i = 0; i < nColumns; i++) {
+		unsigned int id = getVariableId(names[i]);
+		order[i] = Column(id, columns.at(i));
+		max += inputVariables[id].multiplicity + 1;
+	}
+
+	std::sort(order.begin(), order.end());
+	for(unsigned int i = 1; i < nColumns; i++)
+		if (order[i].first == order[i - 1].first)
+			throw cms::Exception("InvalidVariable")
+				<< "Input variable appears in more than one "
+				   "column." << std::endl;
+
+	int *conf = __TMP_ALLOC(nVars + 2, int);
+	double *values = __TMP_ALLOC(max - size + 1, double);
+
+	for(unsigned int event = 0; event < n; event++) {
+		int pos = 0;
+		unsigned int next = 0;
+		for(std::vector<Column>::const_iterator iter = order.begin();
+		    iter != order.end(); ++iter) {
+			std::fill(conf + next, conf + iter->first + 1, pos);
+			double value = iter->second[event];
+			if (!std::isnan(value))
+				values[pos++] = value;
+			next = iter->first + 1;
+		}
+		std::fill(conf + next, conf + size + 1, pos);
+		std::memset(conf + size + 1, 0,
+		            (nVars + 1 - size) * sizeof(int));
+		if (!pos)
+			values[0] = 0.0;
+
+		EvalContext ctx(values, conf, pos);
+		evalInternal(ctx);
+
+		results[event] = ctx.output(output);
+	}
+}
+
+// the lazy variant lays out exactly one slot per supplied input, the
+// slots are only filled once a processor the output depends on is about
+// to read them, processors outside of the output's dependency cone see
+// zeroes
+
+double MVAComputer::evalLazy(const std::vector<AtomicId> &names,
+                             const InputSource &source) const
+{
+	unsigned int size = inputVariables.size();
+	unsigned int n = names.size();
+
+	int *conf = __TMP_ALLOC(nVars + 2, int);
+	int *pending = __TMP_ALLOC(size + 1, int);
+	std::fill(pending, pending + size, -1);
+
+	unsigned int *ids = __TMP_ALLOC(n + 1, unsigned int);
+	for(unsigned int i = 0; i < n; i++) {
+		unsigned int id = getVariableId(names[i]);
+		if (pending[id] >= 0)
+			throw cms::Exception("InvalidVariable")
+				<< "Input variable " << (const char*)names[i]
+				<< " supplied more than once." << std::endl;
+		pending[id] = i;
+		ids[i] = id;
+	}
+
+	unsigned int max;
+	if (isSparse(n))
+		max = sparseOffsets(conf, ids, n);
+	else {
+		std::memset(conf, 0, (nVars + 2) * sizeof(int));
+
+		max = nVars;
+		for(unsigned int i = 0; i < n; i++) {
+			conf[ids[i] + 1]++;
+			max += inputVariables[ids[i]].multiplicity + 1;
+		}
+
+		unsigned int sum = 0;
+		for(unsigned int i = 1; i <= size; i++) {
+			unsigned int tmp = conf[i];
+			conf[i] = sum;
+			sum += tmp;
+		}
+	}
+
+	double *array = __TMP_ALLOC(max - size + 1, double);
+	array[0] = 0.0;
+	for(unsigned int i = 0; i < n; i++)
+		array[conf[ids[i] + 1]++] = 0.0;
+
+	LazyContext ctx(array, conf, n, size, pending, source);
+	evalInternal(ctx);
+
+	return ctx.output(output);
+}
+
+double MVAComputer::deriv(Variable::ValueColumns &values) const
+{
+	unsigned int size = inputVariables.size();
+	unsigned int n = values.size();
+
+	DerivContext ctx;
+	ctx.conf_.resize(nVars + 2);
+	ctx.n_ = n;
+
+	std::vector<unsigned int> ids(n);
+	const AtomicId *names = values.ids();
+	unsigned int max = nVars;
+	for(unsigned int i = 0; i < n; i++) {
+		unsigned int id = getVariableId(names[i]);
+		ids[i] = id;
+		ctx.conf_[id + 1]++;
+		max += inputVariables[id].multiplicity + 1;
+	}
+
+	unsigned int sum = 0;
+	for(unsigned int i = 1; i <= size; i++) {
+		unsigned int tmp = ctx.conf_[i];
+		ctx.conf_[i] = sum;
+		sum += tmp;
+	}
+
+	ctx.values_.resize(max - size + 1);
+	ctx.deriv_.reserve((max - size + 1) * n);
+	double *value = values.values();
+	for(unsigned int i = 0; i < n; i++)
+		ctx.values_[ctx.conf_[ids[i] + 1]++] = value[i];
+
+	evalInternal(ctx);
+
+	std::vector<double> deriv;
+	double result = ctx.output(output, deriv);
+
+	for(unsigned int i = 0; i < n; i++)
+		value[i] = deriv[ctx.conf_[ids[i]]++];
+
+	return result;
+}
+
+// sparse variant of the conf array set-up in eval: a presence bitmap
+// records which input variables have values, the conf entries of those
+// are used as counters and the offsets of the absent variables in
+// between are filled in runs while walking the bitmap in order, so the
+// counting and summing only ever touch the present variables
+
+unsigned int MVAComputer::sparseOffsets(int *conf, const unsigned int *ids,
+                                        unsigned int n) const
+{
+	unsigned int size = inputVariables.size();
+	unsigned int words = (size + 63) / 64;
+
+	uint64_t *present = __TMP_ALLOC(words, uint64_t);
+	std::memset(present, 0, words * sizeof(uint64_t));
+
+	unsigned int max = nVars;
+	for(unsigned int i = 0; i < n; i++) {
+		unsigned int id = ids[i];
+		uint64_t bit = (uint64_t)1 << (id % 64);
+		if (!(present[id / 64] & bit)) {
+			present[id / 64] |= bit;
+			conf[id + 1] = 0;
+		}
+		conf[id + 1]++;
+		max += inputVariables[id].multiplicity + 1;
+	}
+
+	// conf[i + 1] becomes the fill cursor at the start of variable i
+	int sum = 0;
+	unsigned int next = 0;
+	for(unsigned int word = 0; word < words; word++) {
+		for(uint64_t bits = present[word]; bits; bits &= bits - 1) {
+			unsigned int id = word * 64 + __builtin_ctzll(bits);
+			int count = conf[id + 1];
+			std::fill(conf + next, conf + id + 2, sum);
+			sum += count;
+			next = id + 2;
+		}
+	}
+
+	std::fill(conf + next, conf + size + 1, sum);
+	std::memset(conf + size + 1, 0, (nVars + 1 - size) * sizeof(int));
+
+	return max;
+}
+
 template<class T>
 void MVAComputer::evalInternal(T &ctx) const
 {
@@ -191,8 +752,16 @@ void MVAComputer::evalInternal(T &ctx) const
                         edm::typeDemangle(typeid(*iter->processor).name(), demangledName);
 			std::cout << demangledName << std::endl;
 #endif
-			if (status != VarProcessor::kSkip)
-				ctx.eval(&*iter->processor, outConf, output,
+			if (status == VarProcessor::kSkip)
+				;
+			else if (iter->skipped ||
+			         (T::skipInactive && iter->guard >= 0 &&
+			          ctx.values()[ctx.conf()[iter->guard]] == 0.0))
+				// the outputs are single-valued and either not
+				// needed or only ever multiplied by the zero guard
+				ctx.skip(outConf, output, iter->nOutput);
+			else
+				ctx.eval(*iter, outConf, output,
 				         loopStart ? loopStart : loopOutConf,
 				         offset, iter->nOutput);
 
@@ -310,13 +879,29 @@ void MVAComputer::writeCalibration(std::ostream &os,
 // instantiate use cases fo MVAComputer::evalInternal
 
 void MVAComputer::DerivContext::eval(
-		const VarProcessor *proc, int *outConf, double *output,
+		const Processor &proc, int *outConf, double *output,
 		int *loop, unsigned int offset, unsigned int out) const
 {
-	proc->deriv(values(), conf(), output, outConf,
+	proc.processor->deriv(values(), conf(), output, outConf,
 	            loop, offset, n(), out, deriv_);
 }
 
+void MVAComputer::DerivContext::skip(int *outConf, double *output,
+                                     unsigned int out) const
+{
+	for(unsigned int i = 0; i < out; i++) {
+		output[i] = 0.0;
+		outConf[i + 1] = outConf[i] + 1;
+	}
+
+	// constant outputs, zero derivatives
+	std::vector<double>::size_type end = (outConf[out] - n_) * n_;
+	if (deriv_.size() < end)
+		deriv_.resize(end);
+	std::fill(deriv_.begin() + (outConf[0] - n_) * n_,
+	          deriv_.begin() + end, 0.0);
+}
+
 double MVAComputer::DerivContext::output(unsigned int output,
                                          std::vector<double> &derivs) const
 {
@@ -336,7 +921,18 @@ double MVAComputer::DerivContext::output(unsigned int output,
 	return values_[pos];
 }
 
+void MVAComputer::LazyContext::pull(
+		const std::vector<unsigned int> &indices) const
+{
+	for(std::vector<unsigned int>::const_iterator iter = indices.begin();
+	    iter != indices.end() && *iter < nInputs; ++iter)
+		pull(*iter);
+}
+
 template void MVAComputer::evalInternal(EvalContext &ctx) const;
 template void MVAComputer::evalInternal(DerivContext &ctx) const;
+template void MVAComputer::evalInternal(LazyContext &ctx) const;
 
 } // namespace PhysicsTools
+
+#undef __TMP_ALLOC
@@ -1,33 +1,127 @@
+#include <exception>
 #include <memory>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
 #include "PhysicsTools/MVAComputer/interface/Calibration.h"
 #include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
 #include "PhysicsTools/MVAComputer/interface/MVAComputerCache.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputerRegistry.h"
 
 namespace PhysicsTools {
 
-MVAComputerCache::MVAComputerCache() :
+class MVAComputerCache::Builder {
+    public:
+	Builder(MVAComputerCache *cache, Calibration::MVAComputer *calib) :
+		cache(cache), calib(calib) {}
+
+	void operator () () const
+	{
+		try {
+			// the computer takes ownership of the copied calibration,
+			// it is published by the owning thread after joining
+			cache->pending.reset(new MVAComputer(calib, true));
+		} catch(...) {
+			// rethrown by the next update() on the owning thread
+			cache->error = std::current_exception();
+		}
+	}
+
+    private:
+	MVAComputerCache		*cache;
+	Calibration::MVAComputer	*calib;
+};
+
+MVAComputerCache::MVAComputerCache(Mode mode) :
 	containerCacheId(Calibration::MVAComputerContainer::CacheId()),
-	computerCacheId(Calibration::MVAComputer::CacheId())
+	computerCacheId(Calibration::MVAComputer::CacheId()),
+	pendingCacheId(Calibration::MVAComputer::CacheId()),
+	mode(mode), published(false)
 {
 }
 
 MVAComputerCache::~MVAComputerCache()
 {
+	if (builder.joinable())
+		builder.join();
+}
+
+bool MVAComputerCache::collect()
+{
+	// pick up a finished background rebuild without blocking
+	if (builder.joinable() &&
+	    builder.timed_join(boost::posix_time::seconds(0)))
+		wait();
+
+	bool result = published;
+	published = false;
+	return result;
 }
 
 bool MVAComputerCache::update(const Calibration::MVAComputer *computer)
 {
+	// a background rebuild is reported once it has been published
+	bool result = collect();
+
 	if (!computer && !*this)
-		return false;
-	if (computer && !computer->changed(computerCacheId))
-		return false;
+		return result;
+	if (computer && !computer->changed(builder.joinable()
+	                                   ? pendingCacheId
+	                                   : computerCacheId))
+		return result;
+
+	// a rebuild finishing meanwhile is published, report it as well
+	wait();
+	result = published || result;
+	published = false;
+
+	if (computer && mode == kAsynchronous && *this &&
+	    !dynamic_cast<const TrainMVAComputerCalibration*>(computer)) {
+		// evaluation continues on the current computer meanwhile,
+		// the calibration is copied since the EventSetup might
+		// release it before the background thread is done with it
+		std::auto_ptr<Calibration::MVAComputer> calib(
+				new Calibration::MVAComputer(*computer));
+		builder = boost::thread(Builder(this, calib.get()));
+		calib.release();
+		pendingCacheId = computer->getCacheId();
+		containerCacheId = Calibration::MVAComputerContainer::CacheId();
+		return result;
+	} else if (computer && mode == kShared) {
+		boost::atomic_store(&this->computer,
+			MVAComputerRegistry::instance().share(computer));
+		computerCacheId = computer->getCacheId();
+	} else if (computer) {
+		// processors with unchanged calibration are only taken over
+		// from a computer nobody can reach anymore: it is taken out of
+		// the cache first and put back right away if a handle to it is
+		// held, otherwise it stays published until the replacement is
+		// built
+		boost::shared_ptr<MVAComputer> previous =
+			boost::atomic_exchange(&this->computer,
+			                       boost::shared_ptr<MVAComputer>());
+		MVAComputer *reuse = 0;
+		if (boost::get_deleter<Deleter>(previous) && previous.unique())
+			reuse = previous.get();
+		else
+			boost::atomic_store(&this->computer, previous);
 
-	if (computer) {
-		this->computer.reset(new MVAComputer(computer));
+		MVAComputer *replacement;
+		try {
+			replacement = new MVAComputer(computer, reuse);
+		} catch(...) {
+			// the processors taken over have been handed back
+			if (reuse)
+				boost::atomic_store(&this->computer, previous);
+			throw;
+		}
+		publish(replacement);
 		computerCacheId = computer->getCacheId();
 	} else {
-		this->computer.reset();
+		reset();
 		computerCacheId = Calibration::MVAComputer::CacheId();
 	}
 
@@ -39,31 +133,105 @@ bool MVAComputerCache::update(
 			const Calibration::MVAComputerContainer *container,
 			const char *calib)
 {
+	bool result = collect();
+
 	if (!container && !*this)
-		return false;
+		return result;
 	if (container && !container->changed(containerCacheId))
-		return false;
+		return result;
+
+	if (container && mode == kShared) {
+		wait();
+		published = false;
+		boost::atomic_store(&computer,
+			MVAComputerRegistry::instance().share(container, calib));
+		computerCacheId = container->find(calib).getCacheId();
+		containerCacheId = container->getCacheId();
+		return true;
+	}
 
 	if (container) {
 		const Calibration::MVAComputer *computer =
 						&container->find(calib);
-		bool result = update(computer);
+		result = update(computer) || result;
 		containerCacheId = container->getCacheId();
 		return result;
 	}
 
-	this->computer.reset();
+	reset();
 
 	computerCacheId = Calibration::MVAComputer::CacheId();
 	containerCacheId = Calibration::MVAComputerContainer::CacheId();
 	return true;
 }
 
+void MVAComputerCache::wait()
+{
+	if (builder.joinable())
+		builder.join();
+
+	if (!error && pending.get()) {
+		// published here on the owning thread, never by the builder
+		publish(pending.release());
+		computerCacheId = pendingCacheId;
+		pendingCacheId = Calibration::MVAComputer::CacheId();
+		published = true;
+	}
+
+	if (error) {
+		std::exception_ptr error = this->error;
+		this->error = std::exception_ptr();
+
+		// retry with the next update
+		pendingCacheId = Calibration::MVAComputer::CacheId();
+		computerCacheId = Calibration::MVAComputer::CacheId();
+		containerCacheId = Calibration::MVAComputerContainer::CacheId();
+		std::rethrow_exception(error);
+	}
+}
+
+void MVAComputerCache::publish(MVAComputer *computer)
+{
+	boost::shared_ptr<MVAComputer> ptr(computer, Deleter());
+	boost::atomic_store(&this->computer, ptr);
+}
+
+void MVAComputerCache::reset()
+{
+	if (builder.joinable())
+		builder.join();
+	error = std::exception_ptr();
+	pending.reset();
+	pendingCacheId = Calibration::MVAComputer::CacheId();
+	published = false;
+
+	boost::atomic_store(&computer, boost::shared_ptr<MVAComputer>());
+}
+
 std::auto_ptr<MVAComputer> MVAComputerCache::release()
 {
+	wait();
+
+	boost::shared_ptr<MVAComputer> computer =
+		boost::atomic_exchange(&this->computer,
+		                       boost::shared_ptr<MVAComputer>());
+	if (computer && (!computer.unique() ||
+	                 !boost::get_deleter<Deleter>(computer))) {
+		boost::atomic_store(&this->computer, computer);
+		throw cms::Exception("ComputerInUse")
+			<< "MVAComputer to be released from MVAComputerCache "
+			   "is still referenced by a handle or shared via "
+			   "the MVAComputerRegistry." << std::endl;
+	}
+
 	computerCacheId = Calibration::MVAComputer::CacheId();
 	containerCacheId = Calibration::MVAComputerContainer::CacheId();
-	return computer;
+
+	if (!computer)
+		return std::auto_ptr<MVAComputer>();
+
+	boost::get_deleter<Deleter>(computer)->owned = false;
+	return std::auto_ptr<MVAComputer>(computer.get());
 }
 
 } // namespace PhysicsTools
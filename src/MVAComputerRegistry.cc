@@ -0,0 +1,114 @@
+#include <cstddef>
+#include <string>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "PhysicsTools/MVAComputer/interface/Calibration.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputerRegistry.h"
+
+namespace PhysicsTools {
+
+MVAComputerRegistry &MVAComputerRegistry::instance()
+{
+	static MVAComputerRegistry registry;
+	return registry;
+}
+
+MVAComputerRegistry::Handle
+MVAComputerRegistry::get(const Calibration::MVAComputerContainer *container,
+                         const char *calib)
+{
+	return share(container, calib);
+}
+
+MVAComputerRegistry::Handle
+MVAComputerRegistry::get(const Calibration::MVAComputer *computer)
+{
+	return share(computer);
+}
+
+boost::shared_ptr<MVAComputer>
+MVAComputerRegistry::share(const Calibration::MVAComputerContainer *container,
+                           const char *calib)
+{
+	return share(Key(true, container->getCacheId(), calib),
+	             &container->find(calib));
+}
+
+boost::shared_ptr<MVAComputer>
+MVAComputerRegistry::share(const Calibration::MVAComputer *computer)
+{
+	return share(Key(false, computer->getCacheId(), std::string()),
+	             computer);
+}
+
+boost::shared_ptr<MVAComputer>
+MVAComputerRegistry::share(const Key &key,
+                           const Calibration::MVAComputer *computer)
+{
+	typedef boost::shared_ptr<MVAComputer> Ptr;
+
+	// trainer calibrations feed per-module state, never share those
+	if (dynamic_cast<const TrainMVAComputerCalibration*>(computer))
+		return Ptr(new MVAComputer(computer));
+
+	{
+		boost::mutex::scoped_lock scoped_lock(mutex);
+		Map::const_iterator pos = computers.find(key);
+		if (pos != computers.end()) {
+			Ptr result = pos->second.lock();
+			if (result)
+				return result;
+		}
+	}
+
+	// built without holding the lock, so that setting up a large
+	// computer does not block consumers of other calibrations
+	Ptr result(new MVAComputer(computer));
+
+	// concurrent consumers would evaluate it at the same time
+	if (!result->threadSafe())
+		return result;
+
+	boost::mutex::scoped_lock scoped_lock(mutex);
+
+	// drop entries of computers nobody uses anymore
+	for(Map::iterator iter = computers.begin();
+	    iter != computers.end();) {
+		if (iter->second.expired())
+			computers.erase(iter++);
+		else
+			++iter;
+	}
+
+	// another thread might have been faster, use its instance then
+	std::pair<Map::iterator, bool> pos =
+		computers.insert(std::make_pair(key, result));
+	if (!pos.second) {
+		Ptr other = pos.first->second.lock();
+		if (other)
+			return other;
+		pos.first->second = result;
+	}
+
+	return result;
+}
+
+std::size_t MVAComputerRegistry::size() const
+{
+	boost::mutex::scoped_lock scoped_lock(mutex);
+
+	std::size_t size = 0;
+	for(Map::const_iterator iter = computers.begin();
+	    iter != computers.end(); ++iter)
+		if (!iter->second.expired())
+			size++;
+
+	return size;
+}
+
+} // namespace PhysicsTools
@@ -35,11 +35,13 @@ class ProcCategory : public VarProcessor {
 
 	virtual void configure(ConfIterator iter, unsigned int n);
 	virtual void eval(ValueIterator iter, unsigned int n) const;
+	virtual bool reusable() const { return true; }
 
     private:
 	typedef Calibration::ProcCategory::BinLimits BinLimits;
 
-	const Calibration::ProcCategory	*calib;
+	std::vector<BinLimits>	variableBinLimits;
+	std::vector<int>	categoryMapping;
 };
 
 static ProcCategory::Registry registry("ProcCategory");
@@ -47,22 +49,24 @@ static ProcCategory::Registry registry("ProcCategory");
 ProcCategory::ProcCategory(const char *name,
                            const Calibration::ProcCategory *calib,
                            const MVAComputer *computer) :
-	VarProcessor(name, calib, computer), calib(calib)
+	VarProcessor(name, calib, computer),
+	variableBinLimits(calib->variableBinLimits),
+	categoryMapping(calib->categoryMapping)
 {
 }
 
 void ProcCategory::configure(ConfIterator iter, unsigned int n)
 {
-	if (n != calib->variableBinLimits.size())
+	if (n != variableBinLimits.size())
 		return;
 
 	unsigned int categories = 1;
 	for(std::vector<BinLimits>::const_iterator bin =
-					calib->variableBinLimits.begin();
-	    bin != calib->variableBinLimits.end(); bin++)
+					variableBinLimits.begin();
+	    bin != variableBinLimits.end(); bin++)
 		categories *= (bin->size() + 1);
 
-	if (calib->categoryMapping.size() != categories)
+	if (categoryMapping.size() != categories)
 		return;
 
 	while(iter)
@@ -75,15 +79,15 @@ void ProcCategory::eval(ValueIterator iter, unsigned int n) const
 {
 	unsigned int category = 0;
 	for(std::vector<BinLimits>::const_iterator vars =
-					calib->variableBinLimits.begin();
-	    vars != calib->variableBinLimits.end(); vars++, ++iter) {
+					variableBinLimits.begin();
+	    vars != variableBinLimits.end(); vars++, ++iter) {
 		unsigned int idx = std::upper_bound(vars->begin(), vars->end(),
 		                                    *iter) - vars->begin();
 		category *= vars->size() + 1;
 		category += idx;
 	}
 
-	iter(calib->categoryMapping[category]);
+	iter(categoryMapping[category]);
 }
 
 } // anonymous namespace
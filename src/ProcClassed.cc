@@ -34,6 +34,7 @@ class ProcClassed : public VarProcessor {
 
 	virtual void configure(ConfIterator iter, unsigned int n);
 	virtual void eval(ValueIterator iter, unsigned int n) const;
+	virtual bool reusable() const { return true; }
 
     private:
 	unsigned int	nClasses;
@@ -33,6 +33,7 @@ class ProcCount : public VarProcessor {
 
 	virtual void configure(ConfIterator iter, unsigned int n);
 	virtual void eval(ValueIterator iter, unsigned int n) const;
+	virtual bool reusable() const { return true; }
 };
 
 static ProcCount::Registry registry("ProcCount");
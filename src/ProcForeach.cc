@@ -15,6 +15,8 @@
 
 #include <algorithm>
 
+#include <boost/thread/tss.hpp>
+
 #include "FWCore/Utilities/interface/Exception.h"
 
 #include "PhysicsTools/MVAComputer/interface/Variable.h"
@@ -41,6 +43,7 @@ class ProcForeach : public VarProcessor {
 	              ConfigCtx::iterator cur, ConfigCtx::iterator end);
 
 	virtual void eval(ValueIterator iter, unsigned int n) const;
+	virtual bool reusable() const { return true; }
 	virtual std::vector<double> deriv(
 				ValueIterator iter, unsigned int n) const;
 	virtual LoopStatus loop(double *output, int *conf,
@@ -57,11 +60,26 @@ class ProcForeach : public VarProcessor {
 		unsigned int count;
 	};
 
-	inline void reset() const { index = offset = size = 0; }
+	/// loop state of the evaluation running in the current thread
+	struct State {
+		State() : index(0), offset(0), size(0) {}
+
+		unsigned int	index;
+		unsigned int	offset;
+		unsigned int	size;
+	};
+
+	inline State &state() const
+	{
+		State *state = states.get();
+		if (!state)
+			states.reset(state = new State);
+		return *state;
+	}
+
+	inline void reset() const { state() = State(); }
 
-	mutable unsigned int	index;
-	mutable unsigned int	offset;
-	mutable unsigned int	size;
+	mutable boost::thread_specific_ptr<State>	states;
 
 	unsigned int		count;
 };
@@ -105,14 +123,15 @@ ProcForeach::configureLoop(ConfigCtx::Context *ctx_, ConfigCtx::iterator begin,
 
 void ProcForeach::eval(ValueIterator iter, unsigned int n) const
 {
-	iter(offset);
+	State &state = this->state();
+	iter(state.offset);
 
 	while(iter) {
 		unsigned int size = iter.size();
-		if (!this->size)
-			this->size = size;
+		if (!state.size)
+			state.size = size;
 
-		double value = iter[offset];
+		double value = iter[state.offset];
 		iter(value);
 		iter++;
 	}
@@ -121,6 +140,7 @@ void ProcForeach::eval(ValueIterator iter, unsigned int n) const
 std::vector<double> ProcForeach::deriv(
 				ValueIterator iter, unsigned int n) const
 {
+	unsigned int offset = state().offset;
 	std::vector<unsigned int> offsets;
 	unsigned int in = 0, out = 0;
 	while(iter) {
@@ -140,27 +160,28 @@ VarProcessor::LoopStatus
 ProcForeach::loop(double *output, int *conf,
                   unsigned int nOutput, unsigned int &nOffset) const
 {
+	State &state = this->state();
 	bool endIteration = false;
-	if (index++ == count) {
-		index = 0;
+	if (state.index++ == count) {
+		state.index = 0;
 		endIteration = true;
 	}
 
-	if (offset == 0 && !endIteration) {
-		for(int cur = *conf + size; nOutput--; cur += size)
+	if (state.offset == 0 && !endIteration) {
+		for(int cur = *conf + state.size; nOutput--; cur += state.size)
 			*++conf = cur;
 	}
 
 	if (endIteration) {
-		if (++offset >= size) {
-			reset();
+		if (++state.offset >= state.size) {
+			state = State();
 			return kStop;
 		} else
 			return kReset;
-	} else if (offset > size) {
+	} else if (state.offset > state.size) {
 		return kSkip;
 	} else {
-		nOffset = offset;
+		nOffset = state.offset;
 		return kNext;
 	}
 }
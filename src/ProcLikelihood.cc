@@ -41,6 +41,7 @@ class ProcLikelihood : public VarProcessor {
 
 	virtual void configure(ConfIterator iter, unsigned int n);
 	virtual void eval(ValueIterator iter, unsigned int n) const;
+	virtual bool reusable() const { return true; }
 	virtual std::vector<double> deriv(
 				ValueIterator iter, unsigned int n) const;
 
@@ -73,12 +74,12 @@ class ProcLikelihood : public VarProcessor {
 
 	struct HistogramPDF : public PDF {
 		HistogramPDF(const Calibration::HistogramF *calib) :
-			histo(calib) {}
+			histo(*calib) {}
 
 		virtual double eval(double value) const;
 		virtual double deriv(double value) const;
 
-		const Calibration::HistogramF	*histo;
+		Calibration::HistogramF	histo;
 	};
 
 	struct SigBkg {
@@ -135,7 +136,7 @@ double ProcLikelihood::SplinePDF::deriv(double value) const
 
 double ProcLikelihood::HistogramPDF::eval(double value) const
 {
-	return histo->normalizedValue(value) * norm;
+	return histo.normalizedValue(value) * norm;
 }
 
 double ProcLikelihood::HistogramPDF::deriv(double value) const
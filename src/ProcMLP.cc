@@ -42,6 +42,7 @@ class ProcMLP : public VarProcessor {
 
 	virtual void configure(ConfIterator iter, unsigned int n);
 	virtual void eval(ValueIterator iter, unsigned int n) const;
+	virtual bool reusable() const { return true; }
 	virtual std::vector<double> deriv(
 				ValueIterator iter, unsigned int n) const;
 
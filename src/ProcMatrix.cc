@@ -35,6 +35,7 @@ class ProcMatrix : public VarProcessor {
 
 	virtual void configure(ConfIterator iter, unsigned int n);
 	virtual void eval(ValueIterator iter, unsigned int n) const;
+	virtual bool reusable() const { return true; }
 	virtual std::vector<double> deriv(ValueIterator iter,
 	                                  unsigned int n) const;
 
@@ -38,6 +38,8 @@ class ProcMultiply : public VarProcessor {
 
 	virtual void configure(ConfIterator iter, unsigned int n);
 	virtual void eval(ValueIterator iter, unsigned int n) const;
+	virtual bool reusable() const { return true; }
+	virtual bool gates(unsigned int input, unsigned int gate) const;
 	virtual std::vector<double> deriv(
 				ValueIterator iter, unsigned int n) const;
 
@@ -96,6 +98,23 @@ void ProcMultiply::eval(ValueIterator iter, unsigned int n) const
 	}
 }
 
+bool ProcMultiply::gates(unsigned int input, unsigned int gate) const
+{
+	if (input == gate)
+		return false;
+
+	// every product with the input also has the gate as factor
+	for(std::vector<Config>::const_iterator config = out.begin();
+	    config != out.end(); ++config) {
+		Config::const_iterator end = config->end();
+		if (std::find(config->begin(), end, input) != end &&
+		    std::find(config->begin(), end, gate) == end)
+			return false;
+	}
+
+	return true;
+}
+
 std::vector<double> ProcMultiply::deriv(
 				ValueIterator iter, unsigned int n) const
 {
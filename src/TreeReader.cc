@@ -1,16 +1,42 @@
 #include <stdint.h>
 #include <utility>
+#include <algorithm>
+#include <exception>
+#include <limits>
 #include <cstring>
 #include <string>
 #include <vector>
+#include <deque>
 #include <map>
+#include <set>
+#include <memory>
 
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <RVersion.h>
 #include <TString.h>
 #include <TTree.h>
+#include <TChain.h>
+#include <TFile.h>
 #include <TBranch.h>
 #include <TLeaf.h>
 #include <TList.h>
 #include <TKey.h>
+#include <TTreeCache.h>
+#include <TFileCacheRead.h>
+#include <TFriendElement.h>
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+#	include <TMath.h>
+#	include <TBufferFile.h>
+#	include <Bytes.h>
+#endif
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+#	include <TROOT.h>
+#else
+#	include <TThread.h>
+#endif
 
 #include "FWCore/Utilities/interface/Exception.h"
 
@@ -23,7 +49,10 @@ namespace PhysicsTools {
 const double TreeReader::kOptVal = -999.0;
 
 TreeReader::TreeReader() :
-	tree(0), upToDate(false)
+	tree(0), upToDate(false), planned(false), pruned(false),
+	treeNumber(-1), cacheSize(0), prefetch(false), statTree(-1),
+	statBytes(0), statReads(0), seenBytes(0), seenReads(0),
+	bytesDone(0), readsDone(0)
 {
 }
 
@@ -33,7 +62,10 @@ TreeReader::TreeReader(const TreeReader &orig)
 }
 
 TreeReader::TreeReader(TTree *tree, bool skipTarget, bool skipWeight) :
-	tree(tree), upToDate(false)
+	tree(tree), upToDate(false), planned(false), pruned(false),
+	treeNumber(-1), cacheSize(0), prefetch(false), statTree(-1),
+	statBytes(0), statReads(0), seenBytes(0), seenReads(0),
+	bytesDone(0), readsDone(0)
 {
 	automaticAdd(skipTarget, skipWeight);
 }
@@ -57,8 +89,21 @@ TreeReader &TreeReader::operator = (const TreeReader &orig)
 	singleFloat.resize(orig.singleFloat.size());
 	singleInt.resize(orig.singleInt.size());
 	singleBool.resize(orig.singleBool.size());
+	singleShort.resize(orig.singleShort.size());
+	singleUInt.resize(orig.singleUInt.size());
+	singleLong64.resize(orig.singleLong64.size());
+	singleUChar.resize(orig.singleUChar.size());
+
+	arrays = orig.arrays;
 
 	valueMap = orig.valueMap;
+	pruned = orig.pruned;
+	prunedBranches = orig.prunedBranches;
+	cacheSize = orig.cacheSize;
+	prefetch = orig.prefetch;
+	statTree = -1;
+	statBytes = statReads = seenBytes = seenReads = 0;
+	bytesDone = readsDone = 0;
 
 	return *this;
 }
@@ -67,6 +112,7 @@ void TreeReader::setTree(TTree *tree)
 {
 	this->tree = tree;
 	upToDate = false;
+	planned = false;
 }
 
 void TreeReader::addBranch(const std::string &expression,
@@ -109,6 +155,14 @@ void TreeReader::addBranch(TBranch *branch, AtomicId name, bool opt)
 		typeId = 'I';
 	else if (typeName == "Bool_t" || typeName == "bool")
 		typeId = 'B';
+	else if (typeName == "Short_t" || typeName == "short")
+		typeId = 'S';
+	else if (typeName == "UInt_t" || typeName == "unsigned int")
+		typeId = 'i';
+	else if (typeName == "Long64_t" || typeName == "long long")
+		typeId = 'L';
+	else if (typeName == "UChar_t" || typeName == "unsigned char")
+		typeId = 'b';
 	else {
 		multi = true;
 		if (typeName == "vector<double>" ||
@@ -131,7 +185,10 @@ void TreeReader::addBranch(TBranch *branch, AtomicId name, bool opt)
 			   "unsupported type \"" << typeName << "\"."
 			<< std::endl;
 
-	if (multi)
+	// C arrays "x[n]/F" are read in place as multiple values
+	if (!multi && (leaf->GetLeafCount() || leaf->GetLenStatic() > 1))
+		addArray(name, typeId, leaf);
+	else if (multi)
 		addTypeMulti(name, 0, typeId);
 	else
 		addTypeSingle(name, 0, typeId, opt);
@@ -139,6 +196,38 @@ void TreeReader::addBranch(TBranch *branch, AtomicId name, bool opt)
 	valueMap[name].setBranchName(branch->GetName());
 }
 
+void TreeReader::addArray(AtomicId name, char type, TLeaf *leaf)
+{
+	std::map<AtomicId, Value>::const_iterator pos = valueMap.find(name);
+	if (pos != valueMap.end())
+		throw cms::Exception("DuplicateVariable")
+			<< "Duplicate Variable \"" << name << "\"."
+			<< std::endl;
+
+	Array array;
+	array.length = std::max(leaf->GetLenStatic(), 1);
+
+	TLeaf *counter = leaf->GetLeafCount();
+	if (counter) {
+		TString counterType = counter->GetTypeName();
+		if (counterType != "Int_t" && counterType != "int")
+			throw cms::Exception("InvalidBranch")
+				<< "Counter of tree branch \""
+				<< leaf->GetBranch()->GetName() << "\" is of "
+				   "unsupported type \"" << counterType
+				<< "\"." << std::endl;
+		array.counter = counter->GetBranch()->GetName();
+	}
+
+	int index = (int)arrays.size();
+	arrays.push_back(array);
+
+	valueMap[name] = Value(index, true, false, type, true);
+
+	upToDate = false;
+	planned = false;
+}
+
 void TreeReader::setOptional(AtomicId name, bool opt, double optVal)
 {
 	std::map<AtomicId, Value>::iterator pos = valueMap.find(name);
@@ -148,6 +237,7 @@ void TreeReader::setOptional(AtomicId name, bool opt, double optVal)
 			   "TreeReader." << std::endl;
 
 	pos->second.setOpt(opt, optVal);
+	planned = false;
 }
 
 void TreeReader::addTypeSingle(AtomicId name, const void *value, char type, bool opt)
@@ -158,7 +248,8 @@ void TreeReader::addTypeSingle(AtomicId name, const void *value, char type, bool
 			<< "Duplicate Variable \"" << name << "\"."
 			<< std::endl;
 
-	if (type != 'D' && type != 'F' && type != 'I' && type != 'B')
+	if (type != 'D' && type != 'F' && type != 'I' && type != 'B' &&
+	    type != 'S' && type != 'i' && type != 'L' && type != 'b')
 		throw cms::Exception("InvalidType")
 			<< "Unsupported type '" << type << "' in call to"
 			   "TreeReader::addTypeSingle." << std::endl;
@@ -182,6 +273,22 @@ void TreeReader::addTypeSingle(AtomicId name, const void *value, char type, bool
 			index = (int)singleBool.size();
 			singleBool.push_back(Bool());
 			break;
+		    case 'S':
+			index = (int)singleShort.size();
+			singleShort.push_back(Short_t());
+			break;
+		    case 'i':
+			index = (int)singleUInt.size();
+			singleUInt.push_back(UInt_t());
+			break;
+		    case 'L':
+			index = (int)singleLong64.size();
+			singleLong64.push_back(Long64_t());
+			break;
+		    case 'b':
+			index = (int)singleUChar.size();
+			singleUChar.push_back(UChar_t());
+			break;
 		}
 	}
 
@@ -190,6 +297,7 @@ void TreeReader::addTypeSingle(AtomicId name, const void *value, char type, bool
 		valueMap[name].setPtr(value);
 
 	upToDate = false;
+	planned = false;
 }
 
 template<typename T>
@@ -236,6 +344,7 @@ void TreeReader::addTypeMulti(AtomicId name, const void *value, char type)
 		valueMap[name].setPtr(value);
 
 	upToDate = false;
+	planned = false;
 }
 
 void TreeReader::automaticAdd(bool skipTarget, bool skipWeight)
@@ -275,10 +384,20 @@ void TreeReader::reset()
 	singleFloat.clear();
 	singleInt.clear();
 	singleBool.clear();
+	singleShort.clear();
+	singleUInt.clear();
+	singleLong64.clear();
+	singleUChar.clear();
+
+	arrays.clear();
 
 	valueMap.clear();
+	prunedBranches.clear();
 
 	upToDate = false;
+	planned = false;
+	pruned = false;
+	treeNumber = -1;
 }
 
 void TreeReader::update()
@@ -288,11 +407,237 @@ void TreeReader::update()
 			<< "No TTree set in TreeReader::automaticAdd."
 			<< std::endl;
 
+	// the branches of the dropped variables are no longer unpacked,
+	// unless still read for another variable or as an array counter,
+	// all other branches are left alone as the caller might read them
+	if (pruned) {
+		std::set<TString> needed;
+		for(std::map<AtomicId, Value>::const_iterator iter =
+			valueMap.begin(); iter != valueMap.end(); iter++)
+			if (!iter->second.external())
+				needed.insert(iter->second.getBranchName());
+		for(std::vector<Array>::const_iterator iter = arrays.begin();
+		    iter != arrays.end(); ++iter)
+			if (iter->counter.Length())
+				needed.insert(iter->counter);
+
+		for(std::vector<TString>::const_iterator iter =
+			prunedBranches.begin(); iter != prunedBranches.end();
+		    ++iter)
+			if (!needed.count(*iter))
+				tree->SetBranchStatus(*iter, 0);
+	}
+
 	for(std::map<AtomicId, Value>::iterator iter = valueMap.begin();
 	    iter != valueMap.end(); iter++)
 		iter->second.update(this);
 
+	updateCounters();
+
+	// the branch set is known, no need for the cache to learn it
+	if (cacheSize > 0) {
+		tree->SetCacheSize(cacheSize);
+		for(std::map<AtomicId, Value>::const_iterator iter =
+			valueMap.begin(); iter != valueMap.end(); iter++)
+			if (!iter->second.external())
+				tree->AddBranchToCache(
+					iter->second.getBranchName(), kTRUE);
+		for(std::vector<Array>::const_iterator iter = arrays.begin();
+		    iter != arrays.end(); ++iter)
+			if (iter->counter.Length())
+				tree->AddBranchToCache(iter->counter, kTRUE);
+#if ROOT_VERSION_CODE >= ROOT_VERSION(5,34,0)
+		tree->StopCacheLearningPhase();
+#else
+		TTreeCache::SetLearnEntries(1);
+#endif
+		if (prefetch)
+			enablePrefetching();
+	}
+
+	// only count what is read from now on
+	TFile *file = tree->GetCurrentFile();
+	statTree = tree->GetTreeNumber();
+	statBytes = seenBytes = file ? file->GetBytesRead() : 0;
+	statReads = seenReads = file ? file->GetReadCalls() : 0;
+	bytesDone = readsDone = 0;
+
+	treeNumber = tree->GetTreeNumber();
 	upToDate = true;
+	planned = false;
+}
+
+void TreeReader::setCache(Long64_t size, bool prefetch)
+{
+	cacheSize = size;
+	this->prefetch = prefetch;
+
+	upToDate = false;
+}
+
+void TreeReader::enablePrefetching()
+{
+	// per cache instead of TFile.AsyncPrefetching, which would
+	// affect every file the process opens
+#if ROOT_VERSION_CODE >= ROOT_VERSION(5,34,0)
+	TFile *file = tree->GetCurrentFile();
+	TFileCacheRead *cache = file && tree->GetTree()
+	                        ? file->GetCacheRead(tree->GetTree()) : 0;
+	if (cache)
+		cache->SetEnablePrefetching(kTRUE);
+#endif
+}
+
+void TreeReader::account()
+{
+	// a chain closes the previous file when moving on, so its counters
+	// are taken before every entry and booked once the tree changed
+	TFile *file = tree->GetCurrentFile();
+	if (tree->GetTreeNumber() != statTree) {
+		bytesDone += seenBytes - statBytes;
+		readsDone += seenReads - statReads;
+		statTree = tree->GetTreeNumber();
+		statBytes = seenBytes = 0;
+		statReads = seenReads = 0;
+	}
+
+	if (file) {
+		seenBytes = file->GetBytesRead();
+		seenReads = file->GetReadCalls();
+	}
+}
+
+void TreeReader::account(const TreeReader &worker)
+{
+	// worker readers of the parallel loops read through their own files
+	bytesDone += worker.bytesRead();
+	readsDone += worker.readCalls();
+}
+
+Long64_t TreeReader::bytesRead() const
+{
+	TFile *file = tree ? tree->GetCurrentFile() : 0;
+	Long64_t bytes = file && tree->GetTreeNumber() == statTree
+	                 ? file->GetBytesRead() : seenBytes;
+	return bytesDone + bytes - statBytes;
+}
+
+Int_t TreeReader::readCalls() const
+{
+	TFile *file = tree ? tree->GetCurrentFile() : 0;
+	Int_t reads = file && tree->GetTreeNumber() == statTree
+	              ? file->GetReadCalls() : seenReads;
+	return readsDone + reads - statReads;
+}
+
+void TreeReader::treeChanged()
+{
+	treeNumber = tree->GetTreeNumber();
+
+	// the counter maxima of the new tree might exceed the buffers
+	if (!arrays.empty()) {
+		for(std::map<AtomicId, Value>::const_iterator iter =
+			valueMap.begin(); iter != valueMap.end(); iter++)
+			if (iter->second.isArray())
+				iter->second.update(this);
+		planned = false;
+	}
+
+	// the new file comes with a new cache
+	if (cacheSize > 0 && prefetch)
+		enablePrefetching();
+}
+
+Int_t TreeReader::getEntry(Long64_t entry)
+{
+	if (!upToDate)
+		update();
+
+	account();
+	if (tree->LoadTree(entry) >= 0 && tree->GetTreeNumber() != treeNumber)
+		treeChanged();
+
+	return tree->GetEntry(entry);
+}
+
+void TreeReader::updateCounters()
+{
+	// counters read as Int_t variables are shared with those
+	std::map<TString, const Int_t*> counters;
+	for(std::map<AtomicId, Value>::const_iterator iter = valueMap.begin();
+	    iter != valueMap.end(); iter++)
+		if (!iter->second.external() && !iter->second.isMultiple() &&
+		    iter->second.getType() == 'I')
+			counters[iter->second.getBranchName()] =
+				&singleInt[iter->second.getIndex()];
+
+	// otherwise the first array of a counter binds it
+	for(std::vector<Array>::iterator iter = arrays.begin();
+	    iter != arrays.end(); ++iter) {
+		if (!iter->counter.Length()) {
+			iter->countPtr = 0;
+			continue;
+		}
+
+		std::map<TString, const Int_t*>::const_iterator pos =
+					counters.find(iter->counter);
+		if (pos != counters.end()) {
+			iter->countPtr = pos->second;
+			continue;
+		}
+
+		iter->count = 0;
+		iter->countPtr = &iter->count;
+		counters[iter->counter] = iter->countPtr;
+		tree->SetBranchAddress(iter->counter, &iter->count);
+	}
+}
+
+std::vector<std::string> TreeReader::prune(const MVAComputer *mva,
+                                           bool usedOnly)
+{
+	if (!tree)
+		throw cms::Exception("NoTreeAvailable")
+			<< "No TTree set in TreeReader::prune."
+			<< std::endl;
+
+	std::vector<AtomicId> inputs = mva->variables(usedOnly);
+	std::sort(inputs.begin(), inputs.end());
+
+	// the buffers of dropped variables stay allocated but unbound,
+	// only the branches bound by this reader are disabled
+	for(std::map<AtomicId, Value>::iterator iter = valueMap.begin();
+	    iter != valueMap.end(); ) {
+		if (std::binary_search(inputs.begin(), inputs.end(),
+		                       iter->first))
+			++iter;
+		else {
+			if (!iter->second.external())
+				prunedBranches.push_back(
+					iter->second.getBranchName());
+			valueMap.erase(iter++);
+		}
+	}
+
+	pruned = true;
+	upToDate = false;
+	planned = false;
+
+	update();
+
+	return branches();
+}
+
+std::vector<std::string> TreeReader::branches() const
+{
+	std::vector<std::string> result;
+	for(std::map<AtomicId, Value>::const_iterator iter = valueMap.begin();
+	    iter != valueMap.end(); iter++)
+		if (!iter->second.external())
+			result.push_back((const char*)
+			                 iter->second.getBranchName());
+
+	return result;
 }
 
 uint64_t TreeReader::loop(const MVAComputer *mva)
@@ -308,18 +653,244 @@ uint64_t TreeReader::loop(const MVAComputer *mva)
 	Long64_t entries = tree->GetEntries();
 	for(Long64_t entry = 0; entry < entries; entry++)
 	{
-		tree->GetEntry(entry);
+		getEntry(entry);
 		fill(mva);
 	}
 
 	return entries;
 }
 
-double TreeReader::fill(const MVAComputer *mva)
+uint64_t TreeReader::loop(const MVAComputer *mva, TTree *output,
+                          const char *branchName, bool derivatives,
+                          Int_t bufSize)
 {
+	if (!tree)
+		throw cms::Exception("NoTreeAvailable")
+			<< "No TTree set in TreeReader::loop."
+			<< std::endl;
+
+	if (!upToDate)
+		update();
+
+	Double_t result = 0.0;
+	std::vector<TBranch*> branches;
+	branches.push_back(output->Branch(branchName, &result,
+	                                  TString(branchName) + "/D",
+	                                  bufSize));
+
+	// one derivative branch per variable, a vector for multiple values
+	unsigned int nDerivs = derivatives ? valueMap.size() : 0;
+	std::vector<AtomicId> derivNames;
+	std::vector<Double_t> singleDerivs(nDerivs);
+	std::vector<std::vector<double> > multiDerivs(nDerivs);
+	std::vector<std::vector<double>*> multiPtrs(nDerivs);
+	std::vector<bool> multiple;
+	if (derivatives) {
+		for(std::map<AtomicId, Value>::const_iterator iter =
+			valueMap.begin(); iter != valueMap.end(); iter++) {
+			unsigned int i = derivNames.size();
+			TString name = TString(branchName) + "_d" +
+			               (const char*)iter->first;
+			derivNames.push_back(iter->first);
+			multiple.push_back(iter->second.isMultiple());
+			if (multiple.back()) {
+				multiPtrs[i] = &multiDerivs[i];
+				branches.push_back(output->Branch(
+					name, &multiPtrs[i], bufSize));
+			} else
+				branches.push_back(output->Branch(
+					name, &singleDerivs[i],
+					name + "/D", bufSize));
+		}
+	}
+
+	// new branches of the input tree itself are filled individually
+	bool separate = output != tree;
+
+	Long64_t entries = tree->GetEntries();
+	for(Long64_t entry = 0; entry < entries; entry++) {
+		getEntry(entry);
+		fillValues();
+
+		if (!derivatives)
+			result = mva->eval(values);
+		else {
+			result = mva->deriv(values);
+
+			// values of a variable are filled consecutively
+			Variable::ValueColumns::size_type pos = 0;
+			for(unsigned int i = 0; i < nDerivs; i++) {
+				singleDerivs[i] = 0.0;
+				multiDerivs[i].clear();
+				for(; pos < values.size() &&
+				      values.getName(pos) == derivNames[i];
+				    pos++) {
+					if (multiple[i])
+						multiDerivs[i].push_back(
+							values.getValue(pos));
+					else
+						singleDerivs[i] =
+							values.getValue(pos);
+				}
+			}
+		}
+		values.clear();
+
+		if (separate)
+			output->Fill();
+		else
+			for(std::vector<TBranch*>::const_iterator iter =
+				branches.begin(); iter != branches.end();
+			    ++iter)
+				(*iter)->Fill();
+	}
+
+	// the buffers go out of scope, the caller writes the output
+	for(std::vector<TBranch*>::const_iterator iter = branches.begin();
+	    iter != branches.end(); ++iter)
+		(*iter)->ResetAddress();
+
+	return entries;
+}
+
+uint64_t TreeReader::loopColumns(const MVAComputer *mva,
+                                 std::vector<double> &results,
+                                 unsigned int blockSize)
+{
+	if (!tree)
+		throw cms::Exception("NoTreeAvailable")
+			<< "No TTree set in TreeReader::loopColumns."
+			<< std::endl;
+
+	if (!upToDate)
+		update();
+	if (!planned)
+		compile();
+
+	Long64_t entries = tree->GetEntries();
+	results.resize(entries);
+
+	// multiple values and externally bound variables are read per entry
+	bool columnar = blockSize > 0;
 	for(std::map<AtomicId, Value>::const_iterator iter = valueMap.begin();
 	    iter != valueMap.end(); iter++)
-		iter->second.fill(iter->first, this);
+		if (iter->second.isMultiple() || iter->second.external())
+			columnar = false;
+
+	if (!columnar) {
+		for(Long64_t entry = 0; entry < entries; entry++) {
+			getEntry(entry);
+			results[entry] = fill(mva);
+		}
+		return entries;
+	}
+
+	unsigned int nColumns = plan.size();
+	std::vector<AtomicId> names(nColumns);
+	std::vector<std::vector<double> > columns(nColumns);
+	std::vector<const double*> columnPtrs(nColumns);
+	std::vector<TBranch*> branches(nColumns);
+	for(unsigned int i = 0; i < nColumns; i++) {
+		names[i] = plan[i].name;
+		columns[i].resize(blockSize);
+		columnPtrs[i] = &columns[i].front();
+	}
+
+	const double absent = std::numeric_limits<double>::quiet_NaN();
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+	TBufferFile buffer(TBuffer::kWrite, 32 * 1024);
+#endif
+	Int_t branchTree = -1;
+	for(Long64_t entry = 0; entry < entries; ) {
+		// blocks do not cross the trees of a chain
+		account();
+		Long64_t local = tree->LoadTree(entry);
+		TTree *current = tree->GetTree();
+		Long64_t size = std::min<Long64_t>(blockSize,
+		                        current->GetEntries() - local);
+
+		if (tree->GetTreeNumber() != treeNumber)
+			treeChanged();
+		if (tree->GetTreeNumber() != branchTree) {
+			branchTree = tree->GetTreeNumber();
+			std::map<AtomicId, Value>::const_iterator iter =
+							valueMap.begin();
+			for(unsigned int i = 0; i < nColumns; i++, ++iter) {
+				branches[i] = current->GetBranch(
+					iter->second.getBranchName());
+				if (!branches[i])
+					throw cms::Exception("BranchMissing")
+						<< "Tree branch \""
+						<< iter->second.getBranchName()
+						<< "\" missing." << std::endl;
+			}
+		}
+
+		// read the block branch by branch into the columns
+		for(unsigned int i = 0; i < nColumns; i++) {
+			const FillOp &op = plan[i];
+			double *column = &columns[i].front();
+			Long64_t j = 0;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+			// whole baskets are deserialized at once where possible
+			TBranch *branch = branches[i];
+			while(op.bulk && j < size && branch->SupportsBulkRead()) {
+				Long64_t n = branch->GetBulkRead()
+					.GetEntriesSerialized(local + j, buffer);
+				// the buffer starts at the first entry of the basket
+				Int_t basket = TMath::BinarySearch(
+					(Long64_t)branch->GetWriteBasket() + 1,
+					branch->GetBasketEntry(), local + j);
+				Long64_t skip = local + j -
+				                branch->GetBasketEntry()[basket];
+				if (n <= skip)
+					break;
+
+				n = std::min(n - skip, size - j);
+				op.bulk(op, buffer.GetCurrent(), skip, n, column + j);
+				j += n;
+			}
+#endif
+			for(; j < size; j++) {
+				branches[i]->GetEntry(local + j);
+				double value = op.value(op);
+				column[j] = op.optional && value == op.optVal
+				            ? absent : value;
+			}
+		}
+
+		mva->eval(names, columnPtrs, size, &results[entry]);
+		entry += size;
+	}
+
+	return entries;
+}
+
+void TreeReader::compile()
+{
+	plan.clear();
+	plan.reserve(valueMap.size());
+	for(std::map<AtomicId, Value>::const_iterator iter = valueMap.begin();
+	    iter != valueMap.end(); iter++)
+		plan.push_back(iter->second.compile(iter->first, this));
+
+	values.reserve(plan.size());
+	planned = true;
+}
+
+void TreeReader::fillValues()
+{
+	if (!planned)
+		compile();
+
+	for(std::vector<FillOp>::const_iterator op = plan.begin();
+	    op != plan.end(); ++op)
+		op->function(*op, values);
+}
+
+double TreeReader::fill(const MVAComputer *mva)
+{
+	fillValues();
 
 	double result = mva->eval(values);
 	values.clear();
@@ -327,18 +898,755 @@ double TreeReader::fill(const MVAComputer *mva)
 	return result;
 }
 
-Variable::ValueList TreeReader::fill()
+namespace { // anonymous
+
+// independent instance of the tree to be read by a worker thread
+class TreeInstance {
+    public:
+	TreeInstance(TTree *orig);
+	~TreeInstance() { delete chain; delete file; }
+
+	inline TTree *get() const { return tree; }
+
+    private:
+	void attachFriends(TTree *orig);
+
+	TFile						*file;
+	TChain						*chain;
+	TTree						*tree;
+	std::vector<boost::shared_ptr<TreeInstance> >	friends;
+};
+
+TreeInstance::TreeInstance(TTree *orig) :
+	file(0), chain(0), tree(0)
+{
+	TChain *origChain = dynamic_cast<TChain*>(orig);
+	if (origChain) {
+		tree = chain = new TChain(orig->GetName());
+		TIter iter(origChain->GetListOfFiles());
+		while(TObject *obj = iter())
+			chain->Add(obj->GetTitle());
+		attachFriends(orig);
+		return;
+	}
+
+	TFile *origFile = orig->GetCurrentFile();
+	if (!origFile)
+		throw cms::Exception("NotParallelizable")
+			<< "Tree \"" << orig->GetName() << "\" is not "
+			   "read from a file." << std::endl;
+
+	file = TFile::Open(origFile->GetName());
+	if (!file || file->IsZombie())
+		throw cms::Exception("FileOpenError")
+			<< "Could not reopen \"" << origFile->GetName()
+			<< "\"." << std::endl;
+
+	// path of the tree inside the file, "file.root:/dir"
+	TString path = orig->GetDirectory()->GetPath();
+	int pos = path.Index(":/");
+	TString key = pos < 0 ? TString()
+	                      : path(pos + 2, path.Length() - pos - 2);
+	if (key.Length())
+		key += "/";
+	key += orig->GetName();
+
+	tree = dynamic_cast<TTree*>(file->Get(key));
+	if (!tree)
+		throw cms::Exception("TreeMissing")
+			<< "Tree \"" << key << "\" missing in reopened "
+			   "file \"" << origFile->GetName() << "\"."
+			<< std::endl;
+
+	attachFriends(orig);
+}
+
+// only trees read from files, and their friends, can be reopened
+bool reopenable(TTree *orig)
+{
+	if (!dynamic_cast<TChain*>(orig) && !orig->GetCurrentFile())
+		return false;
+
+	TList *list = orig->GetListOfFriends();
+	if (!list)
+		return true;
+
+	TIter iter(list);
+	while(TFriendElement *element =
+				dynamic_cast<TFriendElement*>(iter())) {
+		TTree *origFriend = element->GetTree();
+		if (!origFriend || !reopenable(origFriend))
+			return false;
+	}
+
+	return true;
+}
+
+void TreeInstance::attachFriends(TTree *orig)
+{
+	// branches of friend trees are read through the friends of the
+	// instance, which are reopened the same way
+	TList *list = orig->GetListOfFriends();
+	if (!list)
+		return;
+
+	TIter iter(list);
+	while(TFriendElement *element =
+				dynamic_cast<TFriendElement*>(iter())) {
+		TTree *origFriend = element->GetTree();
+		if (!origFriend)
+			throw cms::Exception("NotParallelizable")
+				<< "Friend \"" << element->GetName() << "\" of "
+				   "tree \"" << orig->GetName() << "\" is not "
+				   "available." << std::endl;
+
+		boost::shared_ptr<TreeInstance> instance(
+					new TreeInstance(origFriend));
+		tree->AddFriend(instance->get(), element->GetName());
+		friends.push_back(instance);
+	}
+}
+
+// entry ranges handed out to the worker threads
+class Schedule {
+    public:
+	Schedule(const std::vector<Long64_t> &clusters, Long64_t minSize);
+
+	bool next(Long64_t &first, Long64_t &last);
+	void fail(const std::exception_ptr &error);
+
+	std::exception_ptr error() const { return error_; }
+
+    private:
+	std::vector<Long64_t>	bounds;
+	unsigned int		pos;
+	std::exception_ptr	error_;
+	boost::mutex		mutex;
+};
+
+Schedule::Schedule(const std::vector<Long64_t> &clusters, Long64_t minSize) :
+	pos(0)
 {
+	// merge small clusters, a range always ends on a cluster boundary
+	for(std::vector<Long64_t>::const_iterator iter = clusters.begin();
+	    iter != clusters.end(); ++iter)
+		if (bounds.empty() || *iter - bounds.back() >= minSize ||
+		    iter + 1 == clusters.end())
+			bounds.push_back(*iter);
+}
+
+bool Schedule::next(Long64_t &first, Long64_t &last)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	if (error_ || pos + 1 >= bounds.size())
+		return false;
+
+	first = bounds[pos];
+	last = bounds[++pos];
+	return true;
+}
+
+void Schedule::fail(const std::exception_ptr &error)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	if (!error_)
+		error_ = error;
+}
+
+} // anonymous namespace
+
+class TreeReader::Worker {
+    public:
+	Worker(const TreeReader &orig, Schedule *schedule,
+	       const MVAComputer *mva, double *results);
+
+	void operator () ();
+
+	const TreeReader &getReader() const { return reader; }
+
+    private:
+	TreeInstance		instance;
+	TreeReader		reader;
+	Schedule		*schedule;
+	const MVAComputer	*mva;
+	double			*results;
+};
+
+TreeReader::Worker::Worker(const TreeReader &orig, Schedule *schedule,
+                           const MVAComputer *mva, double *results) :
+	instance(orig.tree), reader(orig), schedule(schedule),
+	mva(mva), results(results)
+{
+	reader.setTree(instance.get());
+	reader.update();
+}
+
+void TreeReader::Worker::operator () ()
+{
+	try {
+		Long64_t first, last;
+		while(schedule->next(first, last)) {
+			for(Long64_t entry = first; entry < last; entry++) {
+				reader.getEntry(entry);
+				results[entry] = reader.fill(mva);
+			}
+		}
+	} catch(...) {
+		// rethrown by TreeReader::loop on the calling thread
+		schedule->fail(std::current_exception());
+	}
+}
+
+std::vector<Long64_t> TreeReader::clusters() const
+{
+	std::vector<Long64_t> result;
+
+	Long64_t entries = tree->GetEntries();
+	Long64_t entry = 0;
+	while(entry < entries) {
+		Long64_t local = tree->LoadTree(entry);
+		if (local < 0)
+			break;
+
+		// cluster boundaries of the current tree of a chain
+		TTree *current = tree->GetTree();
+		Long64_t base = entry - local;
+		Long64_t size = current->GetEntries();
+		TTree::TClusterIterator iter =
+					current->GetClusterIterator(local);
+		Long64_t start;
+		while((start = iter()) < size)
+			result.push_back(base + start);
+
+		entry = base + size;
+	}
+
+	if (result.empty() || result.back() != entries)
+		result.push_back(entries);
+	if (result.front() != 0)
+		result.insert(result.begin(), 0);
+
+	return result;
+}
+
+void TreeReader::prepareThreads() const
+{
+	// every worker binds its own buffers to its own tree
 	for(std::map<AtomicId, Value>::const_iterator iter = valueMap.begin();
 	    iter != valueMap.end(); iter++)
-		iter->second.fill(iter->first, this);
+		if (iter->second.external())
+			throw cms::Exception("NotParallelizable")
+				<< "Variable \"" << iter->first << "\" is read "
+				   "from external storage." << std::endl;
+
+	// ROOT::EnableThreadSafety is not available before ROOT 6.06
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+	ROOT::EnableThreadSafety();
+#else
+	TThread::Initialize();
+#endif
+}
 
-	Variable::ValueList result = values;
-	values.clear();
+uint64_t TreeReader::loopSerial(const MVAComputer *mva,
+                                std::vector<double> &results)
+{
+	if (!upToDate)
+		update();
+
+	Long64_t entries = tree->GetEntries();
+	results.resize(entries);
+	for(Long64_t entry = 0; entry < entries; entry++) {
+		getEntry(entry);
+		results[entry] = fill(mva);
+	}
+
+	return entries;
+}
+
+uint64_t TreeReader::loop(const MVAComputer *mva, std::vector<double> &results,
+                          unsigned int nThreads)
+{
+	if (!tree)
+		throw cms::Exception("NoTreeAvailable")
+			<< "No TTree set in TreeReader::loop."
+			<< std::endl;
+
+	// the workers cannot open their own copy of a tree in memory
+	if (!reopenable(tree))
+		return loopSerial(mva, results);
+
+	prepareThreads();
+
+	if (!nThreads)
+		nThreads = std::max(1U, boost::thread::hardware_concurrency());
+	// processors that are not thread safe are evaluated by one thread
+	if (!mva->threadSafe())
+		nThreads = 1;
+
+	Long64_t entries = tree->GetEntries();
+	results.resize(entries);
+	if (!entries)
+		return 0;
+
+	// several ranges per worker for load balancing
+	Schedule schedule(clusters(), entries / (nThreads * 16) + 1);
+
+	// files are opened on this thread, only reading is parallel
+	std::vector<boost::shared_ptr<Worker> > workers;
+	for(unsigned int i = 0; i < nThreads; i++)
+		workers.push_back(boost::shared_ptr<Worker>(
+			new Worker(*this, &schedule, mva, &results.front())));
+
+	boost::thread_group threads;
+	for(std::vector<boost::shared_ptr<Worker> >::const_iterator iter =
+		workers.begin(); iter != workers.end(); ++iter)
+		threads.create_thread(boost::bind(&Worker::operator (),
+		                                  iter->get()));
+	threads.join_all();
+
+	for(std::vector<boost::shared_ptr<Worker> >::const_iterator iter =
+		workers.begin(); iter != workers.end(); ++iter)
+		account((*iter)->getReader());
+
+	if (schedule.error())
+		std::rethrow_exception(schedule.error());
+
+	return entries;
+}
+
+namespace { // anonymous
+
+// entries read and unpacked by a producer, ready for evaluation
+struct Block {
+	Long64_t				first;
+	std::vector<Variable::Value>		values;
+	std::vector<unsigned int>		offsets;
+};
+
+// bounded ring of blocks passed from the producers to the evaluators
+class Pipeline {
+    public:
+	Pipeline(unsigned int depth, unsigned int producers);
+
+	Block *acquire();
+	void submit(Block *block);
+	Block *next();
+	void release(Block *block);
+	void done();
+	void abort();
+
+    private:
+	std::vector<Block>		blocks;
+	std::vector<Block*>		idle;
+	std::deque<Block*>		ready;
+	unsigned int			producers;
+	bool				aborted;
+	boost::mutex			mutex;
+	boost::condition_variable	idleCond;
+	boost::condition_variable	readyCond;
+};
+
+Pipeline::Pipeline(unsigned int depth, unsigned int producers) :
+	blocks(depth), producers(producers), aborted(false)
+{
+	for(std::vector<Block>::iterator iter = blocks.begin();
+	    iter != blocks.end(); ++iter)
+		idle.push_back(&*iter);
+}
+
+// producers wait here while all blocks are in flight
+Block *Pipeline::acquire()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	while(idle.empty() && !aborted)
+		idleCond.wait(lock);
+	if (aborted)
+		return 0;
+
+	Block *block = idle.back();
+	idle.pop_back();
+	return block;
+}
+
+void Pipeline::submit(Block *block)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	ready.push_back(block);
+	readyCond.notify_one();
+}
+
+// returns null once all producers are done and all blocks evaluated
+Block *Pipeline::next()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	while(ready.empty() && producers && !aborted)
+		readyCond.wait(lock);
+	if (aborted || ready.empty())
+		return 0;
+
+	Block *block = ready.front();
+	ready.pop_front();
+	return block;
+}
+
+void Pipeline::release(Block *block)
+{
+	boost::mutex::scoped_lock lock(mutex);
+	idle.push_back(block);
+	idleCond.notify_one();
+}
+
+void Pipeline::done()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	if (!--producers)
+		readyCond.notify_all();
+}
+
+void Pipeline::abort()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	aborted = true;
+	idleCond.notify_all();
+	readyCond.notify_all();
+}
+
+void evaluate(Pipeline *pipeline, Schedule *schedule,
+              const MVAComputer *mva, double *results)
+{
+	try {
+		while(Block *block = pipeline->next()) {
+			const Variable::Value *values = &block->values.front();
+			for(unsigned int i = 0; i + 1 < block->offsets.size();
+			    i++)
+				results[block->first + i] = mva->eval(
+					values + block->offsets[i],
+					values + block->offsets[i + 1]);
+			pipeline->release(block);
+		}
+	} catch(...) {
+		schedule->fail(std::current_exception());
+		pipeline->abort();
+	}
+}
+
+} // anonymous namespace
+
+class TreeReader::Producer {
+    public:
+	Producer(const TreeReader &orig, Schedule *schedule,
+	         Pipeline *pipeline, unsigned int blockSize);
+
+	void operator () ();
+
+	const TreeReader &getReader() const { return reader; }
+
+    private:
+	void read(Long64_t first, Long64_t last);
+
+	TreeInstance		instance;
+	TreeReader		reader;
+	Schedule		*schedule;
+	Pipeline		*pipeline;
+	unsigned int		blockSize;
+};
+
+TreeReader::Producer::Producer(const TreeReader &orig, Schedule *schedule,
+                               Pipeline *pipeline, unsigned int blockSize) :
+	instance(orig.tree), reader(orig), schedule(schedule),
+	pipeline(pipeline), blockSize(blockSize)
+{
+	reader.setTree(instance.get());
+	reader.update();
+}
+
+void TreeReader::Producer::operator () ()
+{
+	try {
+		Long64_t first, last;
+		while(schedule->next(first, last))
+			read(first, last);
+	} catch(...) {
+		schedule->fail(std::current_exception());
+		pipeline->abort();
+	}
+
+	pipeline->done();
+}
+
+void TreeReader::Producer::read(Long64_t first, Long64_t last)
+{
+	for(Long64_t entry = first; entry < last; ) {
+		Block *block = pipeline->acquire();
+		if (!block)
+			return;
+
+		// the block keeps its capacity from earlier rounds
+		block->first = entry;
+		block->values.clear();
+		block->offsets.clear();
+		block->offsets.push_back(0);
+
+		Long64_t end = std::min<Long64_t>(entry + blockSize, last);
+		for(; entry < end; entry++) {
+			reader.getEntry(entry);
+			reader.fillValues();
+
+			const Variable::ValueColumns &values = reader.values;
+			for(Variable::ValueColumns::size_type i = 0;
+			    i < values.size(); i++)
+				block->values.push_back(Variable::Value(
+					values.getName(i), values.getValue(i)));
+			reader.values.clear();
+
+			block->offsets.push_back(block->values.size());
+		}
+
+		// never handed out empty, the evaluators take the front
+		if (block->values.empty())
+			block->values.push_back(Variable::Value());
+
+		pipeline->submit(block);
+	}
+}
+
+uint64_t TreeReader::loopPipelined(const MVAComputer *mva,
+                                   std::vector<double> &results,
+                                   unsigned int nReaders,
+                                   unsigned int nEvaluators,
+                                   unsigned int blockSize)
+{
+	if (!tree)
+		throw cms::Exception("NoTreeAvailable")
+			<< "No TTree set in TreeReader::loopPipelined."
+			<< std::endl;
+
+	if (!reopenable(tree))
+		return loopSerial(mva, results);
+
+	prepareThreads();
+
+	// by default the cores are split between the two stages
+	unsigned int cores = std::max(2U, boost::thread::hardware_concurrency());
+	if (!nEvaluators)
+		nEvaluators = cores / 2;
+	if (!nReaders)
+		nReaders = std::max(1U, cores - std::min(cores, nEvaluators));
+	if (!mva->threadSafe())
+		nEvaluators = 1;
+	blockSize = std::max(1U, blockSize);
+
+	Long64_t entries = tree->GetEntries();
+	results.resize(entries);
+	if (!entries)
+		return 0;
+
+	// readers take whole ranges, the blocks of a range are evaluated
+	// in any order but each result goes to the slot of its entry
+	Schedule schedule(clusters(), entries / (nReaders * 16) + 1);
+	Pipeline pipeline(2 * (nReaders + nEvaluators), nReaders);
+
+	std::vector<boost::shared_ptr<Producer> > producers;
+	for(unsigned int i = 0; i < nReaders; i++)
+		producers.push_back(boost::shared_ptr<Producer>(
+			new Producer(*this, &schedule, &pipeline, blockSize)));
+
+	boost::thread_group threads;
+	for(std::vector<boost::shared_ptr<Producer> >::const_iterator iter =
+		producers.begin(); iter != producers.end(); ++iter)
+		threads.create_thread(boost::bind(&Producer::operator (),
+		                                  iter->get()));
+	for(unsigned int i = 0; i < nEvaluators; i++)
+		threads.create_thread(boost::bind(&evaluate, &pipeline,
+		                                  &schedule, mva,
+		                                  &results.front()));
+	threads.join_all();
+
+	for(std::vector<boost::shared_ptr<Producer> >::const_iterator iter =
+		producers.begin(); iter != producers.end(); ++iter)
+		account((*iter)->getReader());
+
+	if (schedule.error())
+		std::rethrow_exception(schedule.error());
+
+	return entries;
+}
+
+class TreeReader::FileWorker {
+    public:
+	FileWorker(const TreeReader &orig, const char *treeName,
+	           const std::vector<std::string> &files,
+	           Schedule *schedule, const MVAComputer *mva,
+	           std::vector<std::vector<double> > &results) :
+		orig(orig), treeName(treeName), files(files),
+		schedule(schedule), mva(mva), results(results),
+		bytesRead(0), readCalls(0) {}
+
+	void operator () ();
+
+	Long64_t getBytesRead() const { return bytesRead; }
+	Long64_t getReadCalls() const { return readCalls; }
+
+    private:
+	void process(unsigned int index);
+
+	const TreeReader			&orig;
+	const char				*treeName;
+	const std::vector<std::string>		&files;
+	Schedule				*schedule;
+	const MVAComputer			*mva;
+	std::vector<std::vector<double> >	&results;
+
+	boost::mutex				mutex;
+	Long64_t				bytesRead;
+	Long64_t				readCalls;
+};
+
+void TreeReader::FileWorker::operator () ()
+{
+	try {
+		Long64_t first, last;
+		while(schedule->next(first, last))
+			for(Long64_t index = first; index < last; index++)
+				process(index);
+	} catch(...) {
+		schedule->fail(std::current_exception());
+	}
+}
+
+void TreeReader::FileWorker::process(unsigned int index)
+{
+	const std::string &name = files[index];
+	std::auto_ptr<TFile> file(TFile::Open(name.c_str()));
+	if (!file.get() || file->IsZombie())
+		throw cms::Exception("FileOpenError")
+			<< "Could not open \"" << name << "\"." << std::endl;
+
+	TTree *tree = dynamic_cast<TTree*>(file->Get(treeName));
+	if (!tree)
+		throw cms::Exception("TreeMissing")
+			<< "Tree \"" << treeName << "\" missing in file \""
+			<< name << "\"." << std::endl;
+
+	// without configured variables every branch of the file is read
+	TreeReader reader(orig);
+	reader.setTree(tree);
+	if (reader.valueMap.empty())
+		reader.automaticAdd();
+	reader.update();
+
+	std::vector<double> &fileResults = results[index];
+	Long64_t entries = tree->GetEntries();
+	fileResults.resize(entries);
+	for(Long64_t entry = 0; entry < entries; entry++) {
+		reader.getEntry(entry);
+		fileResults[entry] = reader.fill(mva);
+	}
+
+	boost::mutex::scoped_lock lock(mutex);
+	bytesRead += reader.bytesRead();
+	readCalls += reader.readCalls();
+}
+
+uint64_t TreeReader::loopFiles(const MVAComputer *mva, const char *treeName,
+                               const std::vector<std::string> &files,
+                               std::vector<double> &results,
+                               unsigned int nThreads)
+{
+	prepareThreads();
+
+	if (!nThreads)
+		nThreads = std::max(1U, boost::thread::hardware_concurrency());
+	nThreads = std::min<unsigned int>(nThreads, files.size());
+	if (!mva->threadSafe())
+		nThreads = 1;
+
+	results.clear();
+	if (files.empty())
+		return 0;
+
+	// one range per file, handed out in file order
+	std::vector<Long64_t> bounds;
+	for(unsigned int i = 0; i <= files.size(); i++)
+		bounds.push_back(i);
+	Schedule schedule(bounds, 1);
+
+	std::vector<std::vector<double> > fileResults(files.size());
+	FileWorker worker(*this, treeName, files, &schedule, mva,
+	                  fileResults);
+
+	boost::thread_group threads;
+	for(unsigned int i = 0; i < nThreads; i++)
+		threads.create_thread(boost::bind(&FileWorker::operator (),
+		                                  &worker));
+	threads.join_all();
+
+	bytesDone += worker.getBytesRead();
+	readsDone += worker.getReadCalls();
+
+	if (schedule.error())
+		std::rethrow_exception(schedule.error());
+
+	// concatenated in the order of the files, as a TChain would
+	std::vector<double>::size_type size = 0;
+	for(unsigned int i = 0; i < files.size(); i++)
+		size += fileResults[i].size();
+	results.reserve(size);
+	for(unsigned int i = 0; i < files.size(); i++)
+		results.insert(results.end(), fileResults[i].begin(),
+		               fileResults[i].end());
+
+	return size;
+}
+
+uint64_t TreeReader::loopFiles(const MVAComputer *mva,
+                               std::vector<double> &results,
+                               unsigned int nThreads)
+{
+	TChain *chain = dynamic_cast<TChain*>(tree);
+	if (!chain)
+		throw cms::Exception("NoChainAvailable")
+			<< "No TChain set in TreeReader::loopFiles."
+			<< std::endl;
+
+	// the entries of a friend are numbered along the whole chain and
+	// cannot be matched to those of a single file
+	TList *friends = chain->GetListOfFriends();
+	if (friends && friends->GetSize())
+		throw cms::Exception("NotParallelizable")
+			<< "Chain \"" << chain->GetName() << "\" has friend "
+			   "trees, which TreeReader::loopFiles cannot read "
+			   "file by file." << std::endl;
+
+	std::vector<std::string> files;
+	TIter iter(chain->GetListOfFiles());
+	while(TObject *obj = iter())
+		files.push_back(obj->GetTitle());
+
+	return loopFiles(mva, chain->GetName(), files, results, nThreads);
+}
+
+Variable::ValueList TreeReader::fill()
+{
+	const Variable::ValueColumns &columns = fillColumns();
+
+	Variable::ValueList result;
+	result.values().reserve(columns.size());
+	for(Variable::ValueColumns::size_type i = 0; i < columns.size(); i++)
+		result.add(columns.getName(i), columns.getValue(i));
 
 	return result;
 }
 
+const Variable::ValueColumns &TreeReader::fillColumns()
+{
+	// refilled in place, the buffers keep their capacity
+	values.clear();
+	fillValues();
+
+	return values;
+}
+
 std::vector<AtomicId> TreeReader::variables() const
 {
 	std::vector<AtomicId> result;
@@ -355,7 +1663,50 @@ void TreeReader::Value::update(TreeReader *reader) const
 		return;
 
 	void *value = 0;
-	if (multiple) {
+	if (array) {
+		// room for the largest counter value in the current tree
+		// of a chain, never shrinks when moving on to the next one
+		Array &store = reader->arrays[index];
+		unsigned int size = store.length;
+		if (store.counter.Length()) {
+			TLeaf *leaf = reader->tree->GetLeaf(store.counter);
+			size *= leaf ? std::max(leaf->GetMaximum(), 1) : 1;
+		}
+		size = std::max(size, store.capacity);
+		store.capacity = size;
+
+		unsigned int elementSize = 0;
+		switch(type) {
+		    case 'D':
+			elementSize = sizeof(Double_t);
+			break;
+		    case 'F':
+			elementSize = sizeof(Float_t);
+			break;
+		    case 'I':
+			elementSize = sizeof(Int_t);
+			break;
+		    case 'B':
+			elementSize = sizeof(Bool_t);
+			break;
+		    case 'S':
+			elementSize = sizeof(Short_t);
+			break;
+		    case 'i':
+			elementSize = sizeof(UInt_t);
+			break;
+		    case 'L':
+			elementSize = sizeof(Long64_t);
+			break;
+		    case 'b':
+			elementSize = sizeof(UChar_t);
+			break;
+		}
+
+		store.data.resize((size * elementSize + sizeof(Long64_t) - 1) /
+		                  sizeof(Long64_t) + 1);
+		value = &store.data.front();
+	} else if (multiple) {
 		switch(type) {
 		    case 'D':
 			reader->multiDouble[index].first =
@@ -392,82 +1743,209 @@ void TreeReader::Value::update(TreeReader *reader) const
 		    case 'B':
 			value = &reader->singleBool[index];
 			break;
+		    case 'S':
+			value = &reader->singleShort[index];
+			break;
+		    case 'i':
+			value = &reader->singleUInt[index];
+			break;
+		    case 'L':
+			value = &reader->singleLong64[index];
+			break;
+		    case 'b':
+			value = &reader->singleUChar[index];
+			break;
 		}
 	}
 
 	reader->tree->SetBranchAddress(name, value);
 }
 
-void TreeReader::Value::fill(AtomicId name, TreeReader *reader) const
+// typed copy operations of the fill plan
+
+template<typename T>
+void TreeReader::FillOp::fillSingle(const FillOp &op,
+				    Variable::ValueColumns &values)
+{ values.add(op.name, *static_cast<const T*>(op.source)); }
+
+template<typename T>
+void TreeReader::FillOp::fillOptional(const FillOp &op,
+				      Variable::ValueColumns &values)
 {
-	if (multiple) {
-		switch(type) {
-		    case 'D': {
-			const std::vector<Double_t> *values =
-				static_cast<const std::vector<Double_t>*>(ptr);
-			if (!values)
-				values = &reader->multiDouble[index].second;
-			for(std::vector<Double_t>::const_iterator iter =
-				values->begin(); iter != values->end(); iter++)
-				reader->values.add(name, *iter);
-			break;
-		    }
-		    case 'F': {
-			const std::vector<Float_t> *values =
-				static_cast<const std::vector<Float_t>*>(ptr);
-			if (!values)
-				values = &reader->multiFloat[index].second;
-			for(std::vector<Float_t>::const_iterator iter =
-				values->begin(); iter != values->end(); iter++)
-				reader->values.add(name, *iter);
-			break;
-		    }
-		    case 'I': {
-			const std::vector<Int_t> *values =
-				static_cast<const std::vector<Int_t>*>(ptr);
-			if (!values)
-				values = &reader->multiInt[index].second;
-			for(std::vector<Int_t>::const_iterator iter =
-				values->begin(); iter != values->end(); iter++)
-				reader->values.add(name, *iter);
-			break;
-		    }
-		    case 'B': {
-			const std::vector<Bool_t> *values =
-				static_cast<const std::vector<Bool_t>*>(ptr);
-			if (!values)
-				values = &reader->multiBool[index].second;
-			for(std::vector<Bool_t>::const_iterator iter =
-				values->begin(); iter != values->end(); iter++)
-				reader->values.add(name, *iter);
-			break;
-		    }
-		}
-	} else {
-		double value = 0.0;
+	double value = *static_cast<const T*>(op.source);
+	if (value != op.optVal)
+		values.add(op.name, value);
+}
+
+template<typename T>
+void TreeReader::FillOp::fillMulti(const FillOp &op,
+				   Variable::ValueColumns &values)
+{
+	const std::vector<T> &vector =
+			*static_cast<const std::vector<T>*>(op.source);
+	for(typename std::vector<T>::const_iterator iter = vector.begin();
+	    iter != vector.end(); ++iter)
+		values.add(op.name, *iter);
+}
+
+template<typename T>
+void TreeReader::FillOp::fillArray(const FillOp &op,
+				   Variable::ValueColumns &values)
+{
+	const T *array = static_cast<const T*>(op.source);
+	unsigned int n = op.count ? *op.count * op.length : op.length;
+	// never beyond the buffer, whatever the counter says
+	n = std::min(n, op.capacity);
+	for(unsigned int i = 0; i < n; i++)
+		values.add(op.name, array[i]);
+}
+
+template<typename T>
+double TreeReader::FillOp::read(const FillOp &op)
+{ return *static_cast<const T*>(op.source); }
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+template<typename T>
+void TreeReader::FillOp::unpack(const FillOp &op, const char *buffer,
+                                Long64_t skip, Long64_t n, double *column)
+{
+	// basket contents are big-endian
+	const double absent = std::numeric_limits<double>::quiet_NaN();
+	char *pos = const_cast<char*>(buffer) + skip * sizeof(T);
+	for(Long64_t i = 0; i < n; i++) {
+		T value;
+		frombuf(pos, &value);
+		column[i] = op.optional && value == op.optVal ? absent : value;
+	}
+}
+#endif
+
+template<typename T>
+void TreeReader::FillOp::bind(bool multiple, bool optional)
+{
+	if (multiple)
+		function = &FillOp::fillMulti<T>;
+	else if (optional)
+		function = &FillOp::fillOptional<T>;
+	else
+		function = &FillOp::fillSingle<T>;
+
+	value = multiple ? 0 : &FillOp::read<T>;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,20,0)
+	bulk = multiple ? 0 : &FillOp::unpack<T>;
+#endif
+	this->optional = optional;
+}
+
+template<typename T>
+void TreeReader::FillOp::bindArray()
+{
+	function = &FillOp::fillArray<T>;
+	value = 0;
+	optional = false;
+}
+
+TreeReader::FillOp TreeReader::Value::compile(AtomicId name,
+                                              TreeReader *reader) const
+{
+	FillOp op;
+	op.name = name;
+	op.optVal = optVal;
+	op.source = ptr;
+	op.count = 0;
+	op.length = 0;
+	op.capacity = 0;
+	op.bulk = 0;
+
+	if (array) {
+		const Array &store = reader->arrays[index];
+		op.source = &store.data.front();
+		op.count = store.countPtr;
+		op.length = store.length;
+		op.capacity = store.capacity;
 
 		switch(type) {
 		    case 'D':
-			value = ptr ? *(const Double_t*)ptr
-			            : reader->singleDouble[index];
+			op.bindArray<Double_t>();
 			break;
 		    case 'F':
-			value = ptr ? *(const Float_t*)ptr
-			            : reader->singleFloat[index];
+			op.bindArray<Float_t>();
 			break;
 		    case 'I':
-			value = ptr ? *(const Int_t*)ptr
-			            : reader->singleInt[index];
+			op.bindArray<Int_t>();
 			break;
 		    case 'B':
-			value = ptr ? *(const Bool_t*)ptr
-			            : reader->singleBool[index];
+			op.bindArray<Bool_t>();
+			break;
+		    case 'S':
+			op.bindArray<Short_t>();
+			break;
+		    case 'i':
+			op.bindArray<UInt_t>();
+			break;
+		    case 'L':
+			op.bindArray<Long64_t>();
+			break;
+		    case 'b':
+			op.bindArray<UChar_t>();
 			break;
 		}
 
-		if (!optional || value != optVal)
-			reader->values.add(name, value);
+		return op;
+	}
+
+	switch(type) {
+	    case 'D':
+		op.bind<Double_t>(multiple, optional);
+		if (!ptr)
+			op.source = multiple
+				? (const void*)&reader->multiDouble[index].second
+				: (const void*)&reader->singleDouble[index];
+		break;
+	    case 'F':
+		op.bind<Float_t>(multiple, optional);
+		if (!ptr)
+			op.source = multiple
+				? (const void*)&reader->multiFloat[index].second
+				: (const void*)&reader->singleFloat[index];
+		break;
+	    case 'I':
+		op.bind<Int_t>(multiple, optional);
+		if (!ptr)
+			op.source = multiple
+				? (const void*)&reader->multiInt[index].second
+				: (const void*)&reader->singleInt[index];
+		break;
+	    case 'B':
+		op.bind<Bool_t>(multiple, optional);
+		if (!ptr)
+			op.source = multiple
+				? (const void*)&reader->multiBool[index].second
+				: (const void*)&reader->singleBool[index].value;
+		break;
+	    case 'S':
+		op.bind<Short_t>(false, optional);
+		if (!ptr)
+			op.source = &reader->singleShort[index];
+		break;
+	    case 'i':
+		op.bind<UInt_t>(false, optional);
+		if (!ptr)
+			op.source = &reader->singleUInt[index];
+		break;
+	    case 'L':
+		op.bind<Long64_t>(false, optional);
+		if (!ptr)
+			op.source = &reader->singleLong64[index];
+		break;
+	    case 'b':
+		op.bind<UChar_t>(false, optional);
+		if (!ptr)
+			op.source = &reader->singleUChar[index];
+		break;
 	}
+
+	return op;
 }
 
 #define TREEREADER_ADD_IMPL(T, C) \
@@ -486,4 +1964,16 @@ TREEREADER_ADD_IMPL(Bool_t, 'B')
 
 #undef TREEREADER_ADD_IMPL
 
+#define TREEREADER_ADD_IMPL(T, C) \
+template<> \
+void TreeReader::addSingle<T>(AtomicId name, const T *value, bool opt) \
+{ addTypeSingle(name, value, C, opt); }
+
+TREEREADER_ADD_IMPL(Short_t, 'S')
+TREEREADER_ADD_IMPL(UInt_t, 'i')
+TREEREADER_ADD_IMPL(Long64_t, 'L')
+TREEREADER_ADD_IMPL(UChar_t, 'b')
+
+#undef TREEREADER_ADD_IMPL
+
 } // namespace PhysicsTools
@@ -41,7 +41,9 @@ VarProcessor::VarProcessor(const char *name,
                            const MVAComputer *computer) :
 	computer(computer),
 	inputVars(Calibration::convert(calib->inputVars)),
-	nInputVars(inputVars.bits())
+	nInputVars(inputVars.bits()),
+	inputIndices(inputVars.indices()),
+	singleValued(false)
 {
 }
 
@@ -57,6 +59,8 @@ void VarProcessor::configure(ConfigCtx &config)
 	if (pos != inputVars.size())
 		return;
 
+	bool inLoop = config.loop;
+
 	ConfIterator iter(inputVars.iter(), config);
 	configure(iter, nInputVars);
 
@@ -74,14 +78,31 @@ void VarProcessor::configure(ConfigCtx &config)
 		config.loop = 0;
 	else if (!config.loop && ctx)
 		config.loop = this;
+
+	// outputs computed in a loop collect one value per iteration
+	inLoop = inLoop || config.loop;
+	if (inLoop)
+		for(ConfigCtx::iterator iter = config.begin() + pos;
+		    iter != config.end(); ++iter)
+			iter->declared = Variable::FLAG_ALL;
+
+	singleValued = !inLoop;
+	for(std::vector<unsigned int>::const_iterator iter =
+		inputIndices.begin(); iter != inputIndices.end(); ++iter)
+		if (config[*iter].declared & (Variable::FLAG_OPTIONAL |
+		                              Variable::FLAG_MULTIPLE))
+			singleValued = false;
 }
 
 VarProcessor::ConfigCtx::ConfigCtx(const std::vector<Variable::Flags>& flags) :
 	loop(0), ctx(0)
 {
+	// nothing is guaranteed about the number of values passed by the user
 	for(std::vector<Variable::Flags>::const_iterator iter = flags.begin();
-	    iter != flags.end(); ++iter)
+	    iter != flags.end(); ++iter) {
 		configs.push_back(Config(*iter, 1));
+		configs.back().declared = Variable::FLAG_ALL;
+	}
 }
 
 VarProcessor::ConfigCtx::Context *
@@ -124,7 +145,7 @@ void VarProcessor::deriv(double *input, int *conf, double *output,
                          unsigned int in, unsigned int out_,
                          std::vector<double> &deriv) const
 {
-	ValueIterator iter(inputVars.iter(), input, conf,
+	ValueIterator iter(inputIndices.data(), nInputVars, input, conf,
 	                   output, outConf, loop, offset);
 
 	eval(iter, nInputVars);
@@ -177,15 +198,15 @@ void VarProcessor::deriv(double *input, int *conf, double *output,
 		return;
 
 	double *m0 = &matrix.front();
-	BitSet::Iterator cur = inputVars.iter();
+	const unsigned int *cur = inputIndices.data();
 	for(unsigned int i = 0; i < nInputVars; i++, ++cur) {
 #ifdef DEBUG_DERIV
 		std::cout << " inputvar " << i << std::endl;
 #endif
-		int *curConf = conf + cur();
+		int *curConf = conf + *cur;
 		unsigned int pos = *curConf;
 #ifdef DEBUG_DERIV
-		std::cout << " -> cur = " << cur() << ", pos = "
+		std::cout << " -> cur = " << *cur << ", pos = "
 		          << pos << std::endl;
 #endif
 		if (loop && curConf >= loop) {
@@ -0,0 +1,163 @@
+// Contention test for the AtomicId interning table.
+//
+// Starts a number of threads which all repeatedly construct AtomicIds
+// from the same set of variable names, as MVAModuleHelper and TreeReader
+// do. Each thread must obtain the same identifiers as the main thread,
+// with the interned string and serial number of the name. Identifiers
+// of literals created with MVA_ATOMIC_ID must be those of the strings.
+//
+// The lookup throughput is reported for each thread count as the best
+// of several runs, it depends on the machine and its load and is for
+// information only, the exit code only reflects the checks.
+//
+// Syntax: testAtomicIdContention [max threads] [lookups per thread]
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "PhysicsTools/MVAComputer/interface/AtomicId.h"
+
+using namespace PhysicsTools;
+
+static const unsigned int nNames = 200;
+static const unsigned int nRuns = 5;
+
+static unsigned int failures = 0;
+
+static void check(bool result, const char *what)
+{
+	if (!result) {
+		std::cout << "FAILED: " << what << std::endl;
+		failures++;
+	}
+}
+
+static void lookup(const std::vector<std::string> *names,
+                   const std::vector<AtomicId> *ids,
+                   unsigned int count, unsigned int *mismatches)
+{
+	unsigned int errors = 0;
+	for(unsigned int i = 0; i < count; i++) {
+		unsigned int index = i % names->size();
+		AtomicId id((*names)[index]);
+		errors += id != (*ids)[index];
+	}
+
+	*mismatches = errors;
+}
+
+// new names interned concurrently by several threads
+static void intern(unsigned int run, unsigned int count,
+                   std::vector<AtomicId> *ids)
+{
+	for(unsigned int i = 0; i < count; i++) {
+		std::ostringstream ss;
+		ss << "concurrentName_" << run << "_" << i;
+		(*ids)[i] = AtomicId(ss.str());
+	}
+}
+
+static void testLiterals()
+{
+	AtomicId target("__TARGET__");
+	check(MVA_ATOMIC_ID("__TARGET__") == target,
+	      "literal and string identifier equal");
+	check(MVA_ATOMIC_ID("jetPt") == AtomicId(std::string("jetPt")),
+	      "literal interned before string");
+	check(std::strcmp(MVA_ATOMIC_ID("jetEta"), "jetEta") == 0,
+	      "literal string");
+	check(!AtomicId() && AtomicId().serial() == 0, "null identifier");
+}
+
+static void testInterning(unsigned int threads)
+{
+	static const unsigned int count = 1000;
+
+	std::vector<std::vector<AtomicId> > ids(threads,
+	                                        std::vector<AtomicId>(count));
+	boost::thread_group group;
+	for(unsigned int i = 0; i < threads; i++)
+		group.create_thread(boost::bind(&intern, threads, count,
+		                                &ids[i]));
+	group.join_all();
+
+	std::vector<unsigned int> serials;
+	for(unsigned int j = 0; j < count; j++) {
+		std::ostringstream ss;
+		ss << "concurrentName_" << threads << "_" << j;
+		for(unsigned int i = 0; i < threads; i++)
+			check(ids[i][j] == ids[0][j] &&
+			      ss.str() == (const char*)ids[i][j],
+			      "concurrently interned names unique");
+		serials.push_back(ids[0][j].serial());
+	}
+
+	std::sort(serials.begin(), serials.end());
+	check(std::unique(serials.begin(), serials.end()) == serials.end() &&
+	      serials.front() > 0, "serial numbers distinct");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int maxThreads = argc > 1 ? std::atoi(argv[1]) : 8;
+	unsigned int count = argc > 2 ? std::atoi(argv[2]) : 1000000;
+
+	testLiterals();
+
+	std::vector<std::string> names;
+	std::vector<AtomicId> ids;
+	for(unsigned int i = 0; i < nNames; i++) {
+		std::ostringstream ss;
+		ss << "jetTrackSip3dSig_" << i;
+		names.push_back(ss.str());
+		ids.push_back(AtomicId(names.back()));
+	}
+
+	for(unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+		testInterning(threads);
+
+		double best = 0.0;
+		for(unsigned int run = 0; run < nRuns; run++) {
+			std::vector<unsigned int> mismatches(threads);
+
+			boost::posix_time::ptime start =
+				boost::posix_time::microsec_clock::
+							universal_time();
+
+			boost::thread_group group;
+			for(unsigned int i = 0; i < threads; i++)
+				group.create_thread(boost::bind(&lookup,
+					&names, &ids, count, &mismatches[i]));
+			group.join_all();
+
+			double seconds = (boost::posix_time::microsec_clock::
+				universal_time() - start).total_microseconds()
+			                 * 1.0e-6;
+			best = std::max(best, count / seconds * 1.0e-6);
+
+			for(unsigned int i = 0; i < threads; i++)
+				check(!mismatches[i],
+				      "concurrent lookups find interned names");
+		}
+
+		std::cout << threads << " threads: "
+		          << (threads * best) << " M lookups/s total, "
+		          << best << " M lookups/s per thread (best of "
+		          << nRuns << " runs)" << std::endl;
+	}
+
+	if (failures)
+		return 1;
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}
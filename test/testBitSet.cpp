@@ -0,0 +1,98 @@
+// Checks the BitSet container against a std::vector<bool>.
+//
+// Sets of different sizes, stored inline and on the heap, with bits
+// set around the word boundaries are compared bit by bit, by count,
+// by iteration over the set bits, after copying and assignment and
+// after the round trip through the persistent representation.
+//
+// Syntax: testBitSet
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "PhysicsTools/MVAComputer/interface/BitSet.h"
+
+#include "PhysicsTools/MVAComputer/test/testMVAComputerCalibration.h"
+
+using namespace PhysicsTools;
+using namespace testMVAComputer;
+
+static bool equal(const BitSet &set, const std::vector<bool> &expected)
+{
+	if (set.size() != expected.size())
+		return false;
+
+	std::vector<unsigned int> indices;
+	for(unsigned int i = 0; i < expected.size(); i++) {
+		if (set[i] != expected[i])
+			return false;
+		if (expected[i])
+			indices.push_back(i);
+	}
+
+	std::vector<unsigned int> iterated;
+	for(BitSet::Iterator iter = set.iter(); iter; iter++)
+		iterated.push_back(iter());
+
+	return set.bits() == indices.size() &&
+	       set.indices() == indices && iterated == indices;
+}
+
+static void test(unsigned int size, unsigned int step, unsigned int offset)
+{
+	std::ostringstream ss;
+	ss << "size " << size << ", every " << step << ". bit from "
+	   << offset;
+	std::string what = ss.str();
+
+	BitSet set(size);
+	std::vector<bool> expected(size, false);
+	check(equal(set, expected), (what + ": empty").c_str());
+
+	for(unsigned int i = offset; i < size; i += step)
+		set[i] = expected[i] = true;
+	if (size)
+		set[size - 1] = expected[size - 1] = true;
+	check(equal(set, expected), (what + ": set").c_str());
+
+	BitSet copy(set);
+	check(equal(copy, expected), (what + ": copy").c_str());
+
+	BitSet assigned(3);
+	assigned = set;
+	check(equal(assigned, expected), (what + ": assignment").c_str());
+
+	std::vector<bool> original = expected;
+	for(unsigned int i = offset; i < size; i += 2 * step)
+		copy[i] = expected[i] = false;
+	check(equal(copy, expected), (what + ": cleared").c_str());
+	check(equal(set, original) && equal(assigned, original),
+	      (what + ": copies independent").c_str());
+
+	if (!size)
+		return;
+
+	BitSet converted = Calibration::convert(Calibration::convert(copy));
+	check(equal(converted, expected), (what + ": conversion").c_str());
+}
+
+int main()
+{
+	static const unsigned int sizes[] = {
+		0, 1, 7, 63, 64, 65, 127, 128, 129, 191, 300
+	};
+	static const unsigned int steps[] = { 1, 3, 64 };
+
+	for(unsigned int i = 0; i < sizeof sizes / sizeof sizes[0]; i++)
+		for(unsigned int j = 0; j < sizeof steps / sizeof steps[0]; j++)
+			for(unsigned int offset = 0; offset < 2; offset++)
+				test(sizes[i], steps[j], offset * 63);
+
+	if (failures)
+		return 1;
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,210 @@
+// Checks how the MVAComputerCache replaces its computer.
+//
+// In synchronous mode the processors of the previous computer are
+// taken over when nobody else holds it, a held computer stays intact
+// and a calibration that fails to build leaves the previous computer
+// in place. A reader thread evaluating through handles while the cache
+// is updated must always see a complete computer. In asynchronous mode
+// the replacement is built in the background and published on the
+// owning thread by the update() that reports it.
+//
+// Syntax: testMVAComputerCache
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <atomic>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputerCache.h"
+#include "PhysicsTools/MVAComputer/interface/Variable.h"
+
+#include "PhysicsTools/MVAComputer/test/testMVAComputerCalibration.h"
+
+using namespace PhysicsTools;
+using namespace testMVAComputer;
+
+typedef MVAComputerCache::Handle Handle;
+
+// output = scale * (x + 2 * y), two processors of which only the
+// second one depends on scale
+static Calibration::MVAComputer *chain(double scale)
+{
+	std::auto_ptr<Calibration::MVAComputer> calib(
+					new Calibration::MVAComputer);
+	linear(*calib, 1.0, 2.0);
+
+	Calibration::ProcLinear linear;
+	linear.inputVars = inputs(3, 2, 2);
+	linear.coeffs.push_back(scale);
+	linear.offset = 0.0;
+	calib->addProcessor(&linear);
+
+	calib->output = 3;
+	return calib.release();
+}
+
+static double eval(const MVAComputer &mva)
+{
+	Variable::Value values[] = {
+		Variable::Value("x", 1.0),
+		Variable::Value("y", 1.0)
+	};
+	return mva.eval(values, values + 2);
+}
+
+static void testSynchronous()
+{
+	std::auto_ptr<Calibration::MVAComputer> calib3(chain(3.0));
+	std::auto_ptr<Calibration::MVAComputer> calib5(chain(5.0));
+	std::auto_ptr<Calibration::MVAComputer> calib7(chain(7.0));
+	std::auto_ptr<Calibration::MVAComputer> broken(chain(9.0));
+	broken->output = 99;
+
+	MVAComputerCache cache;
+	check(cache.update(calib3.get()), "sync: first update");
+	check(eval(*cache) == 9.0, "sync: first computer");
+	check(cache.handle()->reused() == 0, "sync: nothing to take over");
+	check(!cache.update(calib3.get()), "sync: unchanged calibration");
+
+	{
+		// a held computer is left intact by the update
+		Handle held = cache.handle();
+		check(cache.update(calib5.get()), "sync: update while held");
+		check(eval(*held) == 9.0, "sync: held computer unchanged");
+		check(eval(*cache) == 15.0, "sync: replacement while held");
+		check(held != cache.handle(), "sync: new instance");
+		check(cache.handle()->reused() == 0,
+		      "sync: nothing taken from held computer");
+	}
+
+	// nobody holds it, so the first processor is taken over
+	check(cache.update(calib7.get()), "sync: update with reuse");
+	check(eval(*cache) == 21.0, "sync: computer with reused processor");
+	check(cache.handle()->reused() == 1, "sync: first processor reused");
+
+	{
+		Handle held = cache.handle();
+		try {
+			cache.update(broken.get());
+			check(false, "sync: broken calibration throws");
+		} catch(const cms::Exception &e) {
+		}
+		check(cache && eval(*cache) == 21.0,
+		      "sync: previous computer kept after failed build");
+	}
+
+	// the processor taken over by the failed build is handed back
+	try {
+		cache.update(broken.get());
+		check(false, "sync: broken calibration throws again");
+	} catch(const cms::Exception &e) {
+	}
+	check(cache && eval(*cache) == 21.0,
+	      "sync: previous computer intact after failed build with reuse");
+
+	check(cache.update((const Calibration::MVAComputer*)0),
+	      "sync: update to no calibration");
+	check(!cache, "sync: no computer without calibration");
+}
+
+// evaluates whatever the cache holds until told to stop
+static void evaluate(const MVAComputerCache *cache,
+                     std::atomic<bool> *stop, unsigned int *errors)
+{
+	while(!*stop) {
+		Handle computer = cache->handle();
+		if (!computer)
+			continue;
+
+		double value = eval(*computer);
+		if (value != 9.0 && value != 15.0)
+			++*errors;
+	}
+}
+
+static void testConcurrentReader()
+{
+	std::vector<boost::shared_ptr<Calibration::MVAComputer> > calibs;
+	for(unsigned int i = 0; i < 1000; i++)
+		calibs.push_back(boost::shared_ptr<Calibration::MVAComputer>(
+						chain(i % 2 ? 5.0 : 3.0)));
+
+	MVAComputerCache cache;
+	cache.update(calibs[0].get());
+
+	std::atomic<bool> stop(false);
+	unsigned int errors = 0;
+	boost::thread reader(boost::bind(&evaluate, &cache, &stop, &errors));
+
+	unsigned int reused = 0;
+	for(unsigned int i = 1; i < calibs.size(); i++) {
+		cache.update(calibs[i].get());
+		reused += cache.handle()->reused();
+	}
+
+	stop = true;
+	reader.join();
+
+	check(!errors, "sync: concurrent reader sees complete computers");
+	check(eval(*cache) == 15.0, "sync: last computer after updates");
+	std::cout << "processors reused with concurrent reader: " << reused
+	          << " of " << (calibs.size() - 1) << std::endl;
+}
+
+static void testAsynchronous()
+{
+	std::auto_ptr<Calibration::MVAComputer> calib3(chain(3.0));
+	std::auto_ptr<Calibration::MVAComputer> calib5(chain(5.0));
+	std::auto_ptr<Calibration::MVAComputer> broken(chain(9.0));
+	broken->output = 99;
+
+	MVAComputerCache cache(MVAComputerCache::kAsynchronous);
+	check(cache.update(calib3.get()), "async: first update is built");
+	check(eval(*cache) == 9.0, "async: first computer");
+
+	Handle previous = cache.handle();
+	cache.update(calib5.get());
+	check(cache && eval(*previous) == 9.0,
+	      "async: evaluation continues during rebuild");
+
+	// only published on this thread, by update() or wait()
+	boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+	check(cache.handle() == previous,
+	      "async: replacement not published by the builder");
+
+	cache.wait();
+	check(eval(*cache) == 15.0, "async: replacement published");
+	check(cache.update(calib5.get()), "async: publication reported");
+	check(!cache.update(calib5.get()), "async: reported only once");
+
+	check(!cache.update(broken.get()), "async: rebuild in background");
+	try {
+		cache.wait();
+		check(false, "async: failed rebuild throws");
+	} catch(const cms::Exception &e) {
+	}
+	check(cache && eval(*cache) == 15.0,
+	      "async: previous computer kept after failed rebuild");
+}
+
+int main()
+{
+	loadPlugins();
+
+	testSynchronous();
+	testConcurrentReader();
+	testAsynchronous();
+
+	if (failures)
+		return 1;
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef PhysicsTools_MVAComputer_testMVAComputerCalibration_h
+#define PhysicsTools_MVAComputer_testMVAComputerCalibration_h
+
+// ***************************************************************************
+// *                                                                         *
+// *        IMPORTANT NOTE: You would never want to do this by hand!         *
+// *                                                                         *
+// * This is for testing purposes only. Use PhysicsTools/MVATrainer instead. *
+// *                                                                         *
+// ***************************************************************************
+//
+// small calibrations and checks shared by the standalone test programs
+
+#include <iostream>
+
+#include "FWCore/PluginManager/interface/PluginManager.h"
+#include "FWCore/PluginManager/interface/standard.h"
+
+#include "CondFormats/PhysicsToolsObjects/interface/MVAComputer.h"
+
+#include "PhysicsTools/MVAComputer/interface/BitSet.h"
+
+namespace testMVAComputer {
+
+using namespace PhysicsTools;
+
+static unsigned int failures = 0;
+
+inline void check(bool result, const char *what)
+{
+	if (!result) {
+		std::cout << "FAILED: " << what << std::endl;
+		failures++;
+	}
+}
+
+/// the processors are plugins, load them for standalone programs
+inline void loadPlugins()
+{
+	edmplugin::PluginManager::configure(edmplugin::standard::config());
+}
+
+inline void addInput(Calibration::MVAComputer &calib, const char *name)
+{
+	Calibration::Variable var;
+	var.name = name;
+	calib.inputSet.push_back(var);
+}
+
+inline Calibration::BitSet inputs(unsigned int size, unsigned int first,
+                                  unsigned int last)
+{
+	BitSet set(size);
+	for(unsigned int i = first; i <= last; i++)
+		set[i] = true;
+	return Calibration::convert(set);
+}
+
+/// output = offset + cx * x + cy * y
+inline void linear(Calibration::MVAComputer &calib,
+                   double cx, double cy, double offset = 0.0)
+{
+	addInput(calib, "x");
+	addInput(calib, "y");
+
+	Calibration::ProcLinear linear;
+	linear.inputVars = inputs(2, 0, 1);
+	linear.coeffs.push_back(cx);
+	linear.coeffs.push_back(cy);
+	linear.offset = offset;
+	calib.addProcessor(&linear);
+
+	calib.output = 2;
+}
+
+} // namespace testMVAComputer
+
+#endif // PhysicsTools_MVAComputer_testMVAComputerCalibration_h
@@ -0,0 +1,194 @@
+// Checks that the evaluation paths of the MVAComputer agree.
+//
+// A model with many optional inputs is evaluated with few values
+// (sparse set-up), with all values, from value columns, as a batch with
+// NaN for absent values and lazily from an input source. A model with
+// a category flag checks that a processor multiplied by a zero flag is
+// skipped, and that the lazy evaluation then does not compute its input.
+//
+// Syntax: testMVAComputerEval
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <limits>
+
+#include "PhysicsTools/MVAComputer/interface/AtomicId.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
+#include "PhysicsTools/MVAComputer/interface/Variable.h"
+
+#include "PhysicsTools/MVAComputer/test/testMVAComputerCalibration.h"
+
+using namespace PhysicsTools;
+using namespace testMVAComputer;
+
+static const unsigned int nInputs = 40;
+
+static std::string name(unsigned int i)
+{
+	std::ostringstream ss;
+	ss << "v" << i;
+	return ss.str();
+}
+
+// output = 0.5 + sum (i + 1) * vi, absent inputs count as zero
+static void sparseModel(Calibration::MVAComputer &calib)
+{
+	for(unsigned int i = 0; i < nInputs; i++)
+		addInput(calib, name(i).c_str());
+
+	Calibration::ProcOptional optional;
+	optional.inputVars = inputs(nInputs, 0, nInputs - 1);
+	optional.neutralPos.resize(nInputs, 0.0);
+	calib.addProcessor(&optional);
+
+	Calibration::ProcLinear linear;
+	linear.inputVars = inputs(2 * nInputs, nInputs, 2 * nInputs - 1);
+	for(unsigned int i = 0; i < nInputs; i++)
+		linear.coeffs.push_back(i + 1);
+	linear.offset = 0.5;
+	calib.addProcessor(&linear);
+
+	calib.output = 2 * nInputs;
+}
+
+// output = f * y, the processor of y is guarded by f
+static void guardedModel(Calibration::MVAComputer &calib)
+{
+	addInput(calib, "f");
+	addInput(calib, "y");
+
+	Calibration::ProcOptional flag;
+	flag.inputVars = inputs(2, 0, 0);
+	flag.neutralPos.push_back(0.0);
+	calib.addProcessor(&flag);
+
+	Calibration::ProcOptional value;
+	value.inputVars = inputs(3, 1, 1);
+	value.neutralPos.push_back(0.0);
+	calib.addProcessor(&value);
+
+	Calibration::ProcMultiply multiply;
+	multiply.inputVars = inputs(4, 2, 3);
+	multiply.in = 2;
+	multiply.out.resize(1);
+	multiply.out[0].push_back(0);
+	multiply.out[0].push_back(1);
+	calib.addProcessor(&multiply);
+
+	calib.output = 4;
+}
+
+// counts how often each input is computed
+struct Source : public MVAComputer::InputSource {
+	Source(const std::vector<double> &inputs) :
+		inputs(inputs), calls(inputs.size(), 0) {}
+
+	double value(unsigned int i) const
+	{ calls[i]++; return inputs[i]; }
+
+	std::vector<double>			inputs;
+	mutable std::vector<unsigned int>	calls;
+};
+
+static void testSparse()
+{
+	Calibration::MVAComputer calib;
+	sparseModel(calib);
+	MVAComputer mva(&calib);
+
+	double expected = 0.5 + 4 * 2.0 + 18 * -1.0;
+
+	Variable::Value sparse[] = {
+		Variable::Value(name(3), 2.0),
+		Variable::Value(name(17), -1.0)
+	};
+	check(mva.eval(sparse, sparse + 2) == expected, "sparse evaluation");
+
+	std::vector<Variable::Value> dense;
+	for(unsigned int i = 0; i < nInputs; i++)
+		dense.push_back(Variable::Value(name(i), i == 3 ? 2.0 :
+		                                i == 17 ? -1.0 : 0.0));
+	check(mva.eval(dense) == expected, "dense evaluation");
+
+	Variable::ValueColumns columns;
+	columns.add(name(17), -1.0);
+	columns.add(name(3), 2.0);
+	check(mva.eval(columns) == expected, "evaluation of value columns");
+
+	// event 0 as above, event 1 without values, event 2 with all three
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	double v3[] = { 2.0, nan, 1.0 };
+	double v17[] = { -1.0, nan, 1.0 };
+	double v20[] = { nan, nan, 1.0 };
+	std::vector<AtomicId> names;
+	names.push_back(name(3));
+	names.push_back(name(17));
+	names.push_back(name(20));
+	std::vector<const double*> batch;
+	batch.push_back(v3);
+	batch.push_back(v17);
+	batch.push_back(v20);
+	double results[3];
+	mva.eval(names, batch, 3, results);
+	check(results[0] == expected, "batch evaluation, some absent");
+	check(results[1] == 0.5, "batch evaluation, all absent");
+	check(results[2] == 0.5 + 4 + 18 + 21, "batch evaluation, all present");
+
+	names.pop_back();
+	std::vector<double> values;
+	values.push_back(2.0);
+	values.push_back(-1.0);
+	Source source(values);
+	check(mva.evalLazy(names, source) == expected, "lazy evaluation");
+	check(source.calls[0] == 1 && source.calls[1] == 1,
+	      "lazy evaluation computes each input once");
+}
+
+static void testGuards()
+{
+	Calibration::MVAComputer calib;
+	guardedModel(calib);
+	MVAComputer mva(&calib);
+
+	Variable::Value active[] = {
+		Variable::Value("f", 2.0), Variable::Value("y", 3.0)
+	};
+	Variable::Value inactive[] = {
+		Variable::Value("f", 0.0), Variable::Value("y", 3.0)
+	};
+	check(mva.eval(active, active + 2) == 6.0, "active category");
+	check(mva.eval(inactive, inactive + 2) == 0.0, "inactive category");
+
+	std::vector<AtomicId> names;
+	names.push_back("f");
+	names.push_back("y");
+	std::vector<double> values;
+	values.push_back(0.0);
+	values.push_back(3.0);
+
+	Source skipped(values);
+	check(mva.evalLazy(names, skipped) == 0.0, "lazy inactive category");
+	check(skipped.calls[1] == 0,
+	      "input of inactive category not computed");
+
+	values[0] = 2.0;
+	Source evaluated(values);
+	check(mva.evalLazy(names, evaluated) == 6.0, "lazy active category");
+	check(evaluated.calls[1] == 1, "input of active category computed");
+}
+
+int main()
+{
+	loadPlugins();
+
+	testSparse();
+	testGuards();
+
+	if (failures)
+		return 1;
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,185 @@
+// Checks the RDataFrame column definitions against MVAComputer::eval.
+//
+// The functors are called directly, as the data frame would call them
+// from DefineSlot, with the slot number and one value per column. The
+// scalar adapter and the batch adapter are compared with an evaluation
+// of the same values on the linear calibration. A model with optional
+// inputs checks that NaN is treated as an absent value, and the columns
+// are checked against the inputs of the computer.
+//
+// Syntax: testMVAComputerRDF
+
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputerRDF.h"
+#include "PhysicsTools/MVAComputer/interface/Variable.h"
+
+#include "PhysicsTools/MVAComputer/test/testMVAComputerCalibration.h"
+
+using namespace PhysicsTools;
+using namespace testMVAComputer;
+
+static const unsigned int nSlots = 2;
+static const unsigned int nRows = 10;
+
+static double eval(const MVAComputer &mva, double x, double y)
+{
+	Variable::Value values[] = {
+		Variable::Value("x", x),
+		Variable::Value("y", y)
+	};
+	return mva.eval(values, values + 2);
+}
+
+// output = 0.5 + x + 2 * y, absent inputs count as zero
+static void optionalModel(Calibration::MVAComputer &calib)
+{
+	addInput(calib, "x");
+	addInput(calib, "y");
+
+	Calibration::ProcOptional optional;
+	optional.inputVars = inputs(2, 0, 1);
+	optional.neutralPos.resize(2, 0.0);
+	calib.addProcessor(&optional);
+
+	Calibration::ProcLinear linear;
+	linear.inputVars = inputs(4, 2, 3);
+	linear.coeffs.push_back(1.0);
+	linear.coeffs.push_back(2.0);
+	linear.offset = 0.5;
+	calib.addProcessor(&linear);
+
+	calib.output = 4;
+}
+
+static std::vector<std::string> names(const char *first, const char *second)
+{
+	std::vector<std::string> result;
+	result.push_back(first);
+	result.push_back(second);
+	return result;
+}
+
+static void testScalar(const MVAComputer &mva)
+{
+	MVAComputerRDF<double, float> rdf(&mva, names("x", "y"), nSlots);
+
+	bool equal = true;
+	for(unsigned int i = 0; i < nRows; i++) {
+		double x = i * 0.5 - 1.0;
+		float y = i * 0.25f;
+		equal = equal && rdf(i % nSlots, x, y) == eval(mva, x, y);
+	}
+	check(equal, "scalar adapter");
+
+	// the columns are mapped to the variables in the order of the names
+	MVAComputerRDF<double, double> swapped(&mva, names("y", "x"), nSlots);
+	check(swapped(0, 3.0, 1.0) == eval(mva, 1.0, 3.0),
+	      "scalar adapter, columns in other order");
+}
+
+static void testOptional()
+{
+	Calibration::MVAComputer calib;
+	optionalModel(calib);
+	MVAComputer mva(&calib);
+
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	Variable::Value onlyY[] = { Variable::Value("y", 3.0) };
+	double expected = mva.eval(onlyY, onlyY + 1);
+	check(expected == 6.5, "evaluation without x");
+
+	MVAComputerRDF<double, double> rdf(&mva, names("x", "y"), nSlots);
+	check(rdf(1, nan, 3.0) == expected, "scalar adapter, NaN absent");
+	check(rdf(1, 1.0, 3.0) == eval(mva, 1.0, 3.0),
+	      "scalar adapter, slot reused after NaN");
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+	MVAComputerRDFBatch<double, double> batch(&mva, names("x", "y"),
+	                                          nSlots);
+	ROOT::VecOps::RVec<double> x(2), y(2);
+	x[0] = nan;
+	y[0] = 3.0;
+	x[1] = 1.0;
+	y[1] = 3.0;
+	ROOT::VecOps::RVec<double> results = batch(0, x, y);
+	check(results.size() == 2 && results[0] == expected &&
+	      results[1] == eval(mva, 1.0, 3.0), "batch adapter, NaN absent");
+#endif
+}
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+static void testBatch(const MVAComputer &mva)
+{
+	MVAComputerRDFBatch<double, float> rdf(&mva, names("x", "y"), nSlots);
+
+	bool equal = true;
+	for(unsigned int row = 0; row < nRows; row++) {
+		// rows of different lengths, including an empty one
+		ROOT::VecOps::RVec<double> x(row);
+		ROOT::VecOps::RVec<float> y(row);
+		for(unsigned int i = 0; i < row; i++) {
+			x[i] = row - i * 0.5;
+			y[i] = i * 0.25f;
+		}
+
+		ROOT::VecOps::RVec<double> results = rdf(row % nSlots, x, y);
+		equal = equal && results.size() == row;
+		for(unsigned int i = 0; equal && i < row; i++)
+			equal = results[i] == eval(mva, x[i], y[i]);
+	}
+	check(equal, "batch adapter");
+
+	ROOT::VecOps::RVec<double> x(2, 1.0);
+	ROOT::VecOps::RVec<float> y(3, 1.0f);
+	try {
+		rdf(0, x, y);
+		check(false, "batch adapter, columns of different sizes throw");
+	} catch(const cms::Exception &e) {
+	}
+}
+#endif
+
+static void testColumns(const MVAComputer &mva)
+{
+	try {
+		MVAComputerRDF<double, double> rdf(&mva, names("x", "z"),
+		                                   nSlots);
+		check(false, "unknown variable throws");
+	} catch(const cms::Exception &e) {
+	}
+
+	try {
+		MVAComputerRDF<double> rdf(&mva, names("x", "y"), nSlots);
+		check(false, "names not matching the columns throw");
+	} catch(const cms::Exception &e) {
+	}
+}
+
+int main()
+{
+	loadPlugins();
+
+	Calibration::MVAComputer calib;
+	linear(calib, 1.5, -2.0, 0.25);
+	MVAComputer mva(&calib);
+
+	testScalar(mva);
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,14,0)
+	testBatch(mva);
+#endif
+	testOptional();
+	testColumns(mva);
+
+	if (failures)
+		return 1;
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}
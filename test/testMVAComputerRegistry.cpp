@@ -0,0 +1,96 @@
+// Checks the sharing rules of the MVAComputerRegistry.
+//
+// Consumers of the same calibration receive the same instance, also
+// when they ask concurrently, other calibrations their own one. The
+// registry drops computers once the last consumer is gone, and caches
+// in shared mode hand out the registry instance.
+//
+// Syntax: testMVAComputerRegistry
+
+#include <iostream>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputerCache.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputerRegistry.h"
+#include "PhysicsTools/MVAComputer/interface/Variable.h"
+
+#include "PhysicsTools/MVAComputer/test/testMVAComputerCalibration.h"
+
+using namespace PhysicsTools;
+using namespace testMVAComputer;
+
+typedef MVAComputerRegistry::Handle Handle;
+
+static void request(const Calibration::MVAComputerContainer *container,
+                    Handle *result)
+{
+	*result = MVAComputerRegistry::instance().get(container, "a");
+}
+
+int main()
+{
+	loadPlugins();
+
+	MVAComputerRegistry &registry = MVAComputerRegistry::instance();
+
+	Calibration::MVAComputerContainer container;
+	linear(container.add("a"), 1.0, 2.0);
+	linear(container.add("b"), 2.0, 3.0);
+
+	{
+		Handle a1 = registry.get(&container, "a");
+		Handle a2 = registry.get(&container, "a");
+		Handle b = registry.get(&container, "b");
+
+		check(a1 && a1 == a2, "same calibration, same instance");
+		check(a1 != b, "other calibration, other instance");
+		check(registry.size() == 2, "two computers alive");
+		check(a1->threadSafe(), "linear computer is thread safe");
+
+		Variable::Value values[] = {
+			Variable::Value("x", 1.0),
+			Variable::Value("y", 1.5)
+		};
+		check(a1->eval(values, values + 2) == 4.0, "evaluation of a");
+		check(b->eval(values, values + 2) == 6.5, "evaluation of b");
+
+		std::vector<Handle> results(8);
+		boost::thread_group threads;
+		for(unsigned int i = 0; i < results.size(); i++)
+			threads.create_thread(boost::bind(&request, &container,
+			                                  &results[i]));
+		threads.join_all();
+
+		for(unsigned int i = 0; i < results.size(); i++)
+			check(results[i] == a1, "concurrent consumers share");
+	}
+
+	check(registry.size() == 0, "computers released with last handle");
+
+	{
+		Handle first = registry.get(&container, "a");
+		Handle standalone = registry.get(&container.find("a"));
+		check(first != standalone,
+		      "container and standalone calibration are distinct");
+
+		MVAComputerCache cache1(MVAComputerCache::kShared);
+		MVAComputerCache cache2(MVAComputerCache::kShared);
+		check(cache1.update(&container, "a"), "first shared update");
+		check(cache2.update(&container, "a"), "second shared update");
+		check(cache1.handle() == first && cache2.handle() == first,
+		      "shared caches use the registry instance");
+		check(!cache1.update(&container, "a"), "unchanged calibration");
+	}
+
+	check(registry.size() == 0, "computers released with the caches");
+
+	if (failures)
+		return 1;
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,179 @@
+// Checks the TreeReader loops on a chain of two small files.
+//
+// The results of the threaded, pipelined, file-parallel and columnar
+// loops are compared with a plain entry by entry evaluation. A C array
+// branch whose maximum length grows in the second file checks that the
+// array buffers follow the chain from file to file. A tree held in
+// memory is evaluated by the threaded loops on the calling thread.
+//
+// Syntax: testTreeReader
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TChain.h>
+
+#include "PhysicsTools/MVAComputer/interface/AtomicId.h"
+#include "PhysicsTools/MVAComputer/interface/MVAComputer.h"
+#include "PhysicsTools/MVAComputer/interface/TreeReader.h"
+#include "PhysicsTools/MVAComputer/interface/Variable.h"
+
+#include "PhysicsTools/MVAComputer/test/testMVAComputerCalibration.h"
+
+using namespace PhysicsTools;
+using namespace testMVAComputer;
+
+static const Int_t maxLength = 8;
+
+// x = entry, y = entry / 2 and arr[n] = entry + i, n below \a length
+static void writeFile(const char *name, Long64_t first, Long64_t entries,
+                      Int_t length)
+{
+	std::auto_ptr<TFile> file(TFile::Open(name, "RECREATE"));
+
+	Float_t x;
+	Double_t y;
+	Int_t n;
+	Float_t arr[maxLength];
+
+	TTree *tree = new TTree("tree", "testTreeReader");
+	tree->Branch("x", &x, "x/F");
+	tree->Branch("y", &y, "y/D");
+	tree->Branch("n", &n, "n/I");
+	tree->Branch("arr", arr, "arr[n]/F");
+
+	for(Long64_t entry = first; entry < first + entries; entry++) {
+		x = entry;
+		y = entry * 0.5;
+		n = entry % length;
+		for(Int_t i = 0; i < n; i++)
+			arr[i] = entry + i;
+		tree->Fill();
+	}
+
+	file->Write();
+	file->Close();
+}
+
+static void testLoops(TChain *chain, const std::vector<std::string> &files,
+                      const MVAComputer *mva)
+{
+	TreeReader reader;
+	reader.setTree(chain);
+	reader.addBranch("x");
+	reader.addBranch("y");
+	reader.update();
+
+	Long64_t entries = chain->GetEntries();
+	std::vector<double> expected(entries);
+	for(Long64_t entry = 0; entry < entries; entry++) {
+		reader.getEntry(entry);
+		expected[entry] = reader.fill(mva);
+	}
+	check(expected[10] == 10.0 + 2.0 * 5.0, "entry by entry evaluation");
+
+	std::vector<double> results;
+	reader.loop(mva, results, 4);
+	check(results == expected, "threaded loop");
+
+	reader.loopPipelined(mva, results, 2, 2, 16);
+	check(results == expected, "pipelined loop");
+
+	reader.loopFiles(mva, "tree", files, results, 2);
+	check(results == expected, "file-parallel loop");
+
+	reader.loopFiles(mva, results, 2);
+	check(results == expected, "file-parallel loop over chain");
+
+	reader.loopColumns(mva, results, 64);
+	check(results == expected, "columnar loop");
+}
+
+static void testMemoryTree(const MVAComputer *mva)
+{
+	Float_t x;
+	Double_t y;
+	TTree tree("memory", "testTreeReader");
+	tree.SetDirectory(0);
+	tree.Branch("x", &x, "x/F");
+	tree.Branch("y", &y, "y/D");
+	for(Long64_t entry = 0; entry < 100; entry++) {
+		x = entry;
+		y = entry * 0.5;
+		tree.Fill();
+	}
+
+	TreeReader reader;
+	reader.setTree(&tree);
+	reader.addBranch("x");
+	reader.addBranch("y");
+
+	std::vector<double> results;
+	reader.loop(mva, results, 4);
+	check(results.size() == 100 && results[10] == 10.0 + 2.0 * 5.0,
+	      "threaded loop over tree in memory");
+
+	reader.loopPipelined(mva, results, 2, 2, 16);
+	check(results.size() == 100 && results[99] == 99.0 + 2.0 * 49.5,
+	      "pipelined loop over tree in memory");
+}
+
+static void testArrays(TChain *chain, Long64_t split)
+{
+	TreeReader reader;
+	reader.setTree(chain);
+	reader.addBranch("arr");
+	reader.update();
+
+	AtomicId arr("arr");
+	Long64_t entries = chain->GetEntries();
+	bool correct = true;
+	for(Long64_t entry = 0; entry < entries; entry++) {
+		reader.getEntry(entry);
+		const Variable::ValueColumns &values = reader.fillColumns();
+
+		Int_t n = entry % (entry < split ? 3 : maxLength);
+		Int_t i = 0;
+		for(unsigned int j = 0; j < values.size(); j++)
+			if (values.getName(j) == arr &&
+			    values.getValue(j) != entry + i++)
+				correct = false;
+		correct = correct && i == n;
+	}
+
+	check(correct, "C array values across files");
+}
+
+int main()
+{
+	loadPlugins();
+
+	// the arrays of the second file are longer than those of the first
+	std::vector<std::string> files;
+	files.push_back("testTreeReader_1.root");
+	files.push_back("testTreeReader_2.root");
+	writeFile(files[0].c_str(), 0, 1000, 3);
+	writeFile(files[1].c_str(), 1000, 1500, maxLength);
+
+	Calibration::MVAComputer calib;
+	linear(calib, 1.0, 2.0);
+	MVAComputer mva(&calib);
+
+	TChain chain("tree");
+	for(unsigned int i = 0; i < files.size(); i++)
+		chain.Add(files[i].c_str());
+
+	testLoops(&chain, files, &mva);
+	testMemoryTree(&mva);
+	testArrays(&chain, 1000);
+
+	if (failures)
+		return 1;
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}